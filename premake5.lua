@@ -16,6 +16,9 @@ workspace "trive-universe"
 
   flags { "fatalwarnings" }
 
+  -- the engine libraries call into each other, so don't make their link order matter
+  linkgroups "On"
+
   buildoptions { "-Wl,--no-as-needed" }
 
   targetdir "bin/%{cfg.buildcfg}/"
@@ -58,7 +61,7 @@ workspace "trive-universe"
 
   filter {}
 
-  local lib_names = {"epoxy", "glfw", "SDL2"}
+  local lib_names = {"epoxy", "glfw", "SDL2", "pthread"}
   local proj_names = {}
 
   for _, file in ipairs(os.matchfiles("src/lib/[^_]*.cpp")) do
@@ -87,6 +90,14 @@ workspace "trive-universe"
     links ( base_links )
     links ( lib_names )
 
+  -- plays a capture made with TRIVE_CAPTURE back offscreen and times every frame
+  project "replay"
+    kind "consoleapp"
+
+    files { path.join("src", "replay.cpp") }
+    links ( base_links )
+    links ( lib_names )
+
   project(main_project)
     kind "staticlib"
     -- don't link main_project to itself
@@ -103,6 +114,7 @@ workspace "trive-universe"
     --print ("old", #base_links, "new", #test_links) for k, v in next, test_links do print(k, v) end
 
     links ( test_links )
+    links ( lib_names )
 
     targetname "test_trive"
 
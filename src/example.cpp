@@ -26,7 +26,65 @@ auto main (const int argc, char* const * const argv) -> int {
 
   trive::graphics::setup_buffer_objects(&shader_holder, vbo_list, vbo_len, vao_list, vao_len, pos_attr_index, color_attr_index);
   trive::graphics::render(&main_window, color_attr_index);
-  // run_game();
+
+  trive::world::world_t world(1, 1, 1);
+  world.generate_terrain();
+  world.print_light_stats();
+
+  trive::world::chunk_t& chunk = *world.chunks[0];
+
+  {
+    trive::graphics::mesh::chunk_mesh_t chunk_mesh(pos_attr_index, color_attr_index);
+
+    // still on this thread, so the lists are played back straight away
+    trive::graphics::renderer::executor_t executor(main_window);
+    trive::graphics::renderer::command_list_t list;
+    static const GLfloat black[trive::graphics::color_dimensions] = { 0.0, 0.0, 0.0, 1.0 };
+
+    auto show = [&] (void) {
+      list.reset();
+      list.clear(black);
+      chunk_mesh.upload(&list);
+      chunk_mesh.draw(&list);
+      list.swap();
+      executor.execute(list);
+    };
+
+    chunk_mesh.update(&chunk);
+    show();
+    chunk_mesh.print_stats();
+
+    // dig the topmost solid tetrahedron out of the middle of the chunk
+    const trive::world::cell_t dig = chunk.top_solid(trive::world::chunk_size / 2, trive::world::chunk_size / 2);
+
+    std::puts("Press ENTER to dig");
+    std::fgetc(stdin);
+
+    world.set(&chunk, dig, trive::world::air);
+    world.relight();
+    world.print_light_stats();
+    chunk_mesh.update(&chunk);
+    show();
+    chunk_mesh.note_visible();
+    chunk_mesh.print_stats();
+
+    // and put a torch in the hole
+    std::puts("Press ENTER to place a torch");
+    std::fgetc(stdin);
+
+    world.set(&chunk, dig, trive::world::torch);
+    world.relight();
+    world.print_light_stats();
+    chunk_mesh.update(&chunk);
+    show();
+    chunk_mesh.note_visible();
+    chunk_mesh.print_stats();
+
+    std::puts("Press ENTER to play");
+    std::fgetc(stdin);
+  }
+
+  trive::graphics::run_game(&main_window, &main_context, shader_holder, pos_attr_index, color_attr_index);
 
   trive::graphics::metadata::cleanup(&main_window, &main_context, &shader_holder, vbo_list, 1, vao_list, 1);
 
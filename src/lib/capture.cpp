@@ -0,0 +1,359 @@
+#include "../trive.hpp"
+
+namespace trive {
+
+  namespace graphics {
+
+    namespace renderer {
+
+      // nothing a real scene uploads in one call comes near this, so anything bigger means the file is corrupt
+      static const uint64_t max_blob = 1u << 30;
+
+      template <typename value_t>
+      static void put (capture_writer_t* const writer, const value_t value) {
+        writer->write(&value, sizeof (value_t));
+      }
+
+      static void put_string (capture_writer_t* const writer, const std::string& str) {
+        put<uint32_t>(writer, static_cast<uint32_t> (str.size()));
+        writer->write(str.data(), str.size());
+      }
+
+      bool capture_writer_t::open (FILE* const out, const uint32_t width, const uint32_t height) {
+        this->file = out;
+        this->frames = 0;
+        this->bytes = 0;
+        this->failed = false;
+
+        this->write(capture_magic, sizeof capture_magic);
+        put<uint32_t>(this, capture_version);
+        put<uint32_t>(this, width);
+        put<uint32_t>(this, height);
+
+        return ! this->failed;
+      }
+
+      // stops at the first short write; the file is useless past that point anyway
+      void capture_writer_t::write (const void* const data, const size_t size) {
+        if (this->failed || nullptr == this->file || 0 == size) {
+          return;
+        }
+
+        if (size != std::fwrite(data, 1, size, this->file)) {
+          std::fprintf(stderr, "%s: %s\n", __func__, strerror(errno));
+          this->failed = true;
+          return;
+        }
+
+        this->bytes += size;
+      }
+
+      void capture_writer_t::program (const captured_program_t& prog) {
+        put<uint8_t>(this, rec_program);
+        put<uint32_t>(this, prog.name);
+
+        put<uint32_t>(this, static_cast<uint32_t> (prog.attributes.size()));
+        for (auto& attribute: prog.attributes) {
+          put<uint32_t>(this, attribute.index);
+          put_string(this, attribute.name);
+        }
+
+        put<uint32_t>(this, static_cast<uint32_t> (prog.stages.size()));
+        for (auto& stage: prog.stages) {
+          put<uint32_t>(this, stage.type);
+          put_string(this, stage.source);
+        }
+      }
+
+      void capture_writer_t::frame (const command_list_t& list) {
+        const uint8_t* const payload = list.payload.data();
+
+        put<uint8_t>(this, rec_frame);
+        put<uint32_t>(this, static_cast<uint32_t> (list.commands.size()));
+
+        for (auto& command: list.commands) {
+          put<uint8_t>(this, command.kind);
+
+          switch (command.kind) {
+            case cmd_clear: {
+              this->write(payload + command.data, command.data_size);
+              break;
+            }
+
+            case cmd_use_program: {
+              put<uint32_t>(this, command.object);
+              break;
+            }
+
+            case cmd_buffer_data: {
+              put<uint32_t>(this, command.buffer);
+              put<uint64_t>(this, command.size);
+              put<uint64_t>(this, command.data_size);
+              this->write(payload + command.data, command.data_size);
+              break;
+            }
+
+            case cmd_buffer_sub_data: {
+              put<uint32_t>(this, command.buffer);
+              put<uint64_t>(this, command.offset);
+              put<uint64_t>(this, command.size);
+              this->write(payload + command.data, command.data_size);
+              break;
+            }
+
+            case cmd_vertex_attrib: {
+              put<uint32_t>(this, command.object);
+              put<uint32_t>(this, command.buffer);
+              put<uint32_t>(this, command.index);
+              put<uint32_t>(this, command.count);
+              put<uint64_t>(this, command.size);
+              put<uint64_t>(this, command.offset);
+              break;
+            }
+
+            case cmd_multi_draw: {
+              put<uint32_t>(this, command.object);
+              put<uint32_t>(this, command.index);
+              put<uint32_t>(this, command.count);
+              this->write(payload + command.data, nbytes(GLint, command.count));
+              this->write(payload + command.data + padded(nbytes(GLint, command.count)), nbytes(GLsizei, command.count));
+              break;
+            }
+
+            default: { break; }
+          }
+        }
+
+        this->frames++;
+      }
+
+      template <typename value_t>
+      static bool get (FILE* const file, value_t* const value) {
+        return 1 == std::fread(value, sizeof (value_t), 1, file);
+      }
+
+      static bool get_blob (FILE* const file, std::vector<uint8_t>* const blob, const uint64_t size) {
+        if (max_blob < size) {
+          return false;
+        }
+
+        blob->resize(static_cast<size_t> (size));
+        return 0 == size || size == std::fread(blob->data(), 1, blob->size(), file);
+      }
+
+      static bool get_string (FILE* const file, std::string* const str) {
+        uint32_t size;
+        std::vector<uint8_t> blob;
+        if (! get(file, &size) || ! get_blob(file, &blob, size)) {
+          return false;
+        }
+
+        str->assign(blob.begin(), blob.end());
+        return true;
+      }
+
+      static bool read_program (FILE* const file, captured_program_t* const prog) {
+        uint32_t count;
+
+        if (! get(file, &prog->name) || ! get(file, &count)) {
+          return false;
+        }
+        prog->attributes.resize(count);
+        for (auto& attribute: prog->attributes) {
+          if (! get(file, &attribute.index) || ! get_string(file, &attribute.name)) {
+            return false;
+          }
+        }
+
+        if (! get(file, &count)) {
+          return false;
+        }
+        prog->stages.resize(count);
+        for (auto& stage: prog->stages) {
+          if (! get(file, &stage.type) || ! get_string(file, &stage.source)) {
+            return false;
+          }
+        }
+
+        return true;
+      }
+
+      // rebuilt through command_list_t, so a replayed list is laid out exactly like the one that was captured
+      static bool read_frame (FILE* const file, command_list_t* const list) {
+        uint32_t commands;
+        if (! get(file, &commands)) {
+          return false;
+        }
+
+        std::vector<uint8_t> blob;
+
+        for (uint32_t i = 0; i < commands; i++) {
+          uint8_t kind;
+          uint32_t object, buffer, index, count;
+          uint64_t offset, size, data_size;
+
+          if (! get(file, &kind)) {
+            return false;
+          }
+
+          switch (kind) {
+            case cmd_clear: {
+              GLfloat color[color_dimensions];
+              if (! get(file, &color)) {
+                return false;
+              }
+              list->clear(color);
+              break;
+            }
+
+            case cmd_use_program: {
+              if (! get(file, &object)) {
+                return false;
+              }
+              list->use_program(object);
+              break;
+            }
+
+            case cmd_buffer_data: {
+              if (! get(file, &buffer) || ! get(file, &size) || ! get(file, &data_size) || ! get_blob(file, &blob, data_size)) {
+                return false;
+              }
+              list->buffer_data(buffer, size, blob.data(), blob.size());
+              break;
+            }
+
+            case cmd_buffer_sub_data: {
+              if (! get(file, &buffer) || ! get(file, &offset) || ! get(file, &size) || ! get_blob(file, &blob, size)) {
+                return false;
+              }
+              list->buffer_sub_data(buffer, offset, blob.data(), blob.size());
+              break;
+            }
+
+            case cmd_vertex_attrib: {
+              if (! get(file, &object) || ! get(file, &buffer) || ! get(file, &index) || ! get(file, &count) || ! get(file, &size) || ! get(file, &offset)) {
+                return false;
+              }
+              list->vertex_attrib(object, buffer, index, count, size, offset);
+              break;
+            }
+
+            case cmd_multi_draw: {
+              if (! get(file, &object) || ! get(file, &index) || ! get(file, &count) || max_blob < nbytes(GLint, static_cast<uint64_t> (count))) {
+                return false;
+              }
+
+              std::vector<GLint> firsts(count);
+              std::vector<GLsizei> counts(count);
+              if (count != std::fread(firsts.data(), sizeof (GLint), count, file) || count != std::fread(counts.data(), sizeof (GLsizei), count, file)) {
+                return false;
+              }
+              list->multi_draw(object, index, firsts.data(), counts.data(), count);
+              break;
+            }
+
+            case cmd_swap: {
+              list->swap();
+              break;
+            }
+
+            default: {
+              return false;
+            }
+          }
+        }
+
+        return true;
+      }
+
+      bool read_capture (FILE* const file, capture_t* const capture) {
+        char magic[sizeof capture_magic];
+        uint32_t version;
+
+        if (! get(file, &magic) || 0 != std::memcmp(magic, capture_magic, sizeof magic) || ! get(file, &version) || capture_version != version) {
+          std::fprintf(stderr, "%s: not a version %u trive capture\n", __func__, capture_version);
+          return false;
+        }
+
+        if (! get(file, &capture->width) || ! get(file, &capture->height)) {
+          std::fprintf(stderr, "%s: truncated header\n", __func__);
+          return false;
+        }
+
+        for (size_t records = 0; ; records++) {
+          uint8_t record;
+          if (! get(file, &record)) {
+            return true; // end of the capture
+          }
+
+          bool ok = false;
+
+          if (rec_program == record) {
+            capture->programs.push_back(captured_program_t());
+            ok = read_program(file, &capture->programs.back());
+          } else if (rec_frame == record) {
+            capture->frames.push_back(command_list_t());
+            ok = read_frame(file, &capture->frames.back());
+          }
+
+          if (! ok) {
+            std::fprintf(stderr, "%s: record %zu is truncated or corrupt\n", __func__, records);
+            return false;
+          }
+        }
+      }
+
+      // the same steps shader_t takes, from sources instead of files; 0 if it doesn't compile or link
+      GLuint build_program (const captured_program_t& prog) {
+        const GLuint name = glCreateProgram();
+
+        for (auto& attribute: prog.attributes) {
+          glBindAttribLocation(name, attribute.index, attribute.name.c_str());
+        }
+
+        std::vector<GLuint> shader_ids;
+        bool ok = true;
+
+        for (auto& stage: prog.stages) {
+          const GLuint shader_id = glCreateShader(stage.type);
+          const GLchar* const source = stage.source.c_str();
+          const GLint source_len = static_cast<GLint> (stage.source.size());
+
+          glShaderSource(shader_id, 1, &source, &source_len);
+          glCompileShader(shader_id);
+
+          GLint compiled = GL_FALSE;
+          glGetShaderiv(shader_id, GL_COMPILE_STATUS, &compiled);
+          if (GL_FALSE == compiled) {
+            std::fprintf(stderr, "%s: a stage of program %u doesn't compile\n", __func__, prog.name);
+            ok = false;
+          }
+
+          glAttachShader(name, shader_id);
+          shader_ids.push_back(shader_id);
+        }
+
+        GLint linked = GL_FALSE;
+        if (ok) {
+          glLinkProgram(name);
+          glGetProgramiv(name, GL_LINK_STATUS, &linked);
+          if (GL_FALSE == linked) {
+            std::fprintf(stderr, "%s: program %u doesn't link\n", __func__, prog.name);
+          }
+        }
+
+        for (auto shader_id: shader_ids) {
+          glDetachShader(name, shader_id);
+          glDeleteShader(shader_id);
+        }
+
+        if (GL_FALSE == linked) {
+          glDeleteProgram(name);
+          return 0;
+        }
+
+        return name;
+      }
+    }
+  }
+}
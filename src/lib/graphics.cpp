@@ -47,10 +47,51 @@ namespace trive {
       return true;
     }
 
-    bool run_game (SDL_Window* const * const window) {
-      bool loop = true;
+    // the simulation runs here while the render thread plays back the frame before; space digs the column under the cursor
+    // and steps it along, t puts a torch in the last hole, and r, g and b change the background
+    bool run_game (SDL_Window* const * const window, SDL_GLContext* const context, shader::shader_t* const shader, const GLuint pos_attr_index, const GLuint color_attr_index) {
+      world::world_t world(1, 1, 1);
+      world.generate_terrain();
+
+      mesh::chunk_mesh_t chunk_mesh(pos_attr_index, color_attr_index);
+      world::chunk_t* const chunk = world.chunks[0];
+
+      renderer::render_thread_t render_thread(*window, *context);
+
+      // TRIVE_CAPTURE=file records every frame the render thread plays, for the replay tool
+      const char* const capture_path = std::getenv("TRIVE_CAPTURE");
+      FILE* capture_fp = nullptr;
+      renderer::capture_writer_t capture;
+
+      if (nullptr != capture_path) {
+        int width = 0, height = 0;
+        SDL_GetWindowSize(*window, &width, &height);
+
+        capture_fp = std::fopen(capture_path, "wb");
+        if (nullptr == capture_fp || ! capture.open(capture_fp, static_cast<uint32_t> (width), static_cast<uint32_t> (height))) {
+          std::fprintf(stderr, "%s: %s: %s\n", __func__, capture_path, strerror(errno));
+          if (nullptr != capture_fp) {
+            std::fclose(capture_fp);
+          }
+          return false;
+        }
+
+        capture.program({ shader->shader_program, shader->attributes, shader->stages });
+        render_thread.capture = &capture;
+      }
+
+      render_thread.start();
+
+      GLfloat background[color_dimensions] = { 0.0, 0.0, 0.0, 1.0 };
+      const int32_t cursor_z = world::chunk_size / 2;
+      int32_t cursor_x = 0;
+      world::cell_t last_hole = world::cell_t();
+      bool dug = false, loop = true;
+      uint64_t visible_at = 0;
 
       while (loop) {
+        renderer::command_list_t* const list = render_thread.begin_frame();
+
         SDL_Event event;
         while ( SDL_PollEvent(&event) ) {
           if (event.type == SDL_QUIT) { loop = false; }
@@ -64,24 +105,32 @@ namespace trive {
               }
 
               case SDLK_r: {
-                // Cover with red and update
-                glClearColor(1.0, 0.0, 0.0, 1.0);
-                glClear(GL_COLOR_BUFFER_BIT);
-                SDL_GL_SwapWindow(*window);
+                background[0] = 1.0; background[1] = 0.0; background[2] = 0.0;
                 break;
               }
               case SDLK_g: {
-                // Cover with green and update
-                glClearColor(0.0, 1.0, 0.0, 1.0);
-                glClear(GL_COLOR_BUFFER_BIT);
-                SDL_GL_SwapWindow(*window);
+                background[0] = 0.0; background[1] = 1.0; background[2] = 0.0;
                 break;
               }
               case SDLK_b: {
-                // Cover with blue and update
-                glClearColor(0.0, 0.0, 1.0, 1.0);
-                glClear(GL_COLOR_BUFFER_BIT);
-                SDL_GL_SwapWindow(*window);
+                background[0] = 0.0; background[1] = 0.0; background[2] = 1.0;
+                break;
+              }
+
+              case SDLK_SPACE: {
+                const world::cell_t dig = chunk->top_solid(cursor_x, cursor_z);
+
+                if (world.set(chunk, dig, world::air)) {
+                  last_hole = dig;
+                  dug = true;
+                }
+                cursor_x = (cursor_x + 1) % static_cast<int32_t> (world::chunk_size);
+                break;
+              }
+              case SDLK_t: {
+                if (dug) {
+                  world.set(chunk, last_hole, world::torch);
+                }
                 break;
               }
 
@@ -89,8 +138,41 @@ namespace trive {
             }
           }
         }
+
+        world.relight();
+        chunk_mesh.update(chunk);
+
+        list->clear(background);
+        list->use_program(shader->shader_program);
+        chunk_mesh.upload(list);
+        chunk_mesh.draw(list);
+        list->swap();
+
+        if (chunk_mesh.edit_pending && 0 == visible_at) {
+          visible_at = render_thread.submitted.load() + 1;
+        }
+
+        render_thread.submit();
+
+        // the edit is on screen once the render thread is done with the frame that carried it
+        if (0 != visible_at && render_thread.consumed.load() >= visible_at) {
+          chunk_mesh.note_visible();
+          chunk_mesh.print_stats();
+          visible_at = 0;
+        }
+      }
+
+      render_thread.stop();
+      render_thread.print_timing();
+
+      if (nullptr != capture_fp) {
+        if (0 != std::fclose(capture_fp) || capture.failed) {
+          std::fprintf(stderr, "%s: %s is incomplete\n", __func__, capture_path);
+          return false;
+        }
+        std::printf("captured %" PRIu64 " frames, %" PRIu64 " bytes to %s\n", capture.frames, capture.bytes, capture_path);
       }
-      // end of function
+
       return true;
     }
 
@@ -0,0 +1,305 @@
+#include "../trive.hpp"
+
+namespace trive {
+
+  namespace world {
+
+    namespace light {
+
+      static const uint8_t material_emission[material_count] = {
+        0,  // air
+        0,  // stone
+        0,  // dirt
+        0,  // grass
+        14, // torch
+      };
+
+      bool opaque (const uint8_t material) {
+        return air != material;
+      }
+
+      uint8_t emission (const uint8_t material) {
+        return material_emission[material];
+      }
+
+      // nothing loaded above means open sky
+      bool sky_source (const chunk_t& chunk, const cell_t& cell) {
+        return nullptr == chunk.neighbors[3]
+          && static_cast<int32_t> (chunk_size) - 1 == cell.cube[1]
+          && ! opaque(chunk.materials[ chunk_t::cell_index(cell) ]);
+      }
+
+      // four times the height of the centroid
+      static int32_t height4 (const cell_t& cell) {
+        int32_t verts[tetra_verticies][dimensions];
+        cell_verticies(cell, verts);
+        return verts[0][1] + verts[1][1] + verts[2][1] + verts[3][1];
+      }
+
+      // faces take their light from the cell they look onto, so the solid cells around this one need remeshing;
+      // the ones in other chunks are left to deliver() since this may be running next to them
+      static void touch (chunk_t* const chunk, const cell_t& cell) {
+        for (uint8_t f = 0; f < tetra_faces; f++) {
+          cell_t n = face_neighbor(cell, f);
+          chunk_t* const owner = chunk->resolve(&n);
+
+          if (nullptr == owner || ! opaque(owner->materials[ chunk_t::cell_index(n) ])) {
+            continue;
+          }
+
+          if (owner == chunk) {
+            chunk->mark_dirty(n);
+          } else {
+            chunk->light_outbox.push_back({ owner, chunk_t::cell_index(n), 0, 0, offer_dirty, false });
+          }
+        }
+      }
+
+      static void accept_add (chunk_t* const chunk, const uint32_t index, const uint8_t level, const uint8_t channel) {
+        if (opaque(chunk->materials[index]) || level <= chunk->light[channel][index]) {
+          return;
+        }
+
+        chunk->light[channel][index] = level;
+        touch(chunk, chunk_t::index_cell(index));
+        chunk->light_add[channel].push_back({ index, level });
+      }
+
+      // darken the cell if its light came from where the removal came from, otherwise it's lit by something else and should spread back
+      static void accept_remove (chunk_t* const chunk, const uint32_t index, const uint8_t old_level, const bool downward, const uint8_t channel) {
+        const uint8_t level = chunk->light[channel][index];
+        if (0 == level) {
+          return;
+        }
+
+        const cell_t cell = chunk_t::index_cell(index);
+
+        if (opaque(chunk->materials[index]) || (sky_light == channel && sky_source(*chunk, cell))) {
+          chunk->light_add[channel].push_back({ index, level });
+          return;
+        }
+
+        const bool fed_by_sky = sky_light == channel && downward && max_light == old_level && max_light == level;
+
+        if (level < old_level || fed_by_sky) {
+          chunk->light[channel][index] = 0;
+          touch(chunk, cell);
+          chunk->light_remove[channel].push_back({ index, level });
+        } else {
+          chunk->light_add[channel].push_back({ index, level });
+        }
+      }
+
+      // run one chunk's add or remove queues dry, only ever writing to that chunk
+      static size_t drain (chunk_t* const chunk, const uint8_t kind) {
+        size_t visited = 0;
+
+        for (uint8_t ch = 0; ch < light_channels; ch++) {
+          std::vector<light_node_t>& queue = (offer_remove == kind) ? chunk->light_remove[ch] : chunk->light_add[ch];
+
+          // walk it front to back while it grows, so it's breadth-first without popping
+          for (size_t i = 0; i < queue.size(); i++) {
+            const light_node_t node = queue[i];
+
+            if (offer_add == kind && node.level != chunk->light[ch][node.index]) {
+              continue; // stale: raised or darkened since it was queued
+            }
+            visited++;
+
+            const cell_t cell = chunk_t::index_cell(node.index);
+            const int32_t height = height4(cell);
+
+            for (uint8_t f = 0; f < tetra_faces; f++) {
+              cell_t n = face_neighbor(cell, f);
+
+              // skylight falls straight down its column without fading; a lower neighbour in the next cube over is a step sideways
+              const bool downward = n.cube[0] == cell.cube[0] && n.cube[2] == cell.cube[2] && height4(n) < height;
+              uint8_t level = static_cast<uint8_t> (node.level - 1);
+              if (sky_light == ch && max_light == node.level && downward) {
+                level = max_light;
+              }
+
+              chunk_t* const owner = chunk->resolve(&n);
+              if (nullptr == owner || (offer_add == kind && 0 == level)) {
+                continue;
+              }
+
+              const uint32_t index = chunk_t::cell_index(n);
+
+              if (owner != chunk) {
+                chunk->light_outbox.push_back({ owner, index, offer_add == kind ? level : node.level, ch, kind, downward });
+              } else if (offer_add == kind) {
+                accept_add(chunk, index, level, ch);
+              } else {
+                accept_remove(chunk, index, node.level, downward, ch);
+              }
+            }
+          }
+
+          queue.clear();
+        }
+
+        return visited;
+      }
+
+      static bool has_work (const chunk_t& chunk, const uint8_t kind) {
+        for (uint8_t ch = 0; ch < light_channels; ch++) {
+          if (! (offer_remove == kind ? chunk.light_remove[ch] : chunk.light_add[ch]).empty()) {
+            return true;
+          }
+        }
+        return false;
+      }
+
+      static void deliver (chunk_t* const chunk) {
+        for (auto& offer: chunk->light_outbox) {
+          switch (offer.kind) {
+            case offer_add: {
+              accept_add(offer.chunk, offer.index, offer.level, offer.channel);
+              break;
+            }
+            case offer_remove: {
+              accept_remove(offer.chunk, offer.index, offer.level, offer.downward, offer.channel);
+              break;
+            }
+            default: {
+              offer.chunk->mark_dirty(chunk_t::index_cell(offer.index));
+              break;
+            }
+          }
+        }
+
+        chunk->light_outbox.clear();
+      }
+
+      // light a freshly generated chunk from scratch
+      void seed (chunk_t* const chunk) {
+        for (uint32_t index = 0; index < chunk_cells; index++) {
+          const uint8_t material = chunk->materials[index];
+
+          chunk->light[block_light][index] = emission(material);
+          chunk->light[sky_light][index] = 0;
+
+          if (0 != emission(material)) {
+            chunk->light_add[block_light].push_back({ index, emission(material) });
+          }
+
+          if (sky_source(*chunk, chunk_t::index_cell(index))) {
+            chunk->light[sky_light][index] = max_light;
+            chunk->light_add[sky_light].push_back({ index, max_light });
+          }
+        }
+      }
+
+      // whatever lit the cell before is taken away, then it gets its own light and whatever its neighbors shine in
+      void on_edit (chunk_t* const chunk, const cell_t& cell) {
+        const uint32_t index = chunk_t::cell_index(cell);
+        const uint8_t material = chunk->materials[index];
+
+        for (uint8_t ch = 0; ch < light_channels; ch++) {
+          const uint8_t old_level = chunk->light[ch][index];
+
+          if (0 != old_level) {
+            chunk->light[ch][index] = 0;
+            chunk->light_remove[ch].push_back({ index, old_level });
+          }
+        }
+
+        if (0 != emission(material)) {
+          chunk->light[block_light][index] = emission(material);
+          chunk->light_add[block_light].push_back({ index, emission(material) });
+        }
+
+        if (opaque(material)) {
+          return;
+        }
+
+        if (sky_source(*chunk, cell)) {
+          chunk->light[sky_light][index] = max_light;
+          chunk->light_add[sky_light].push_back({ index, max_light });
+        }
+
+        for (uint8_t f = 0; f < tetra_faces; f++) {
+          cell_t n = face_neighbor(cell, f);
+          chunk_t* const owner = chunk->resolve(&n);
+
+          if (nullptr == owner) {
+            continue;
+          }
+
+          const uint32_t n_index = chunk_t::cell_index(n);
+          for (uint8_t ch = 0; ch < light_channels; ch++) {
+            if (0 != owner->light[ch][n_index]) {
+              owner->light_add[ch].push_back({ n_index, owner->light[ch][n_index] });
+            }
+          }
+        }
+      }
+
+      // chunks with queued work are drained side by side, then whatever crossed a border is handed over and the next pass
+      // picks it up; all removals land before anything is spread, or light would spread from cells that are about to go dark
+      void propagate (const std::vector<chunk_t*>& chunks, light_stats_t* const stats) {
+        const auto start = std::chrono::steady_clock::now();
+        const size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+
+        std::atomic<size_t> visited(0);
+        size_t passes = 0, threads_used = 1;
+        std::vector<chunk_t*> active;
+
+        for (const uint8_t kind: { offer_remove, offer_add }) {
+          for (;;) {
+            active.clear();
+            for (auto chunk: chunks) {
+              if (has_work(*chunk, kind)) {
+                active.push_back(chunk);
+              }
+            }
+
+            if (active.empty()) {
+              break;
+            }
+            passes++;
+
+            // one edit usually only wakes one chunk, and starting threads for it would cost more than the work
+            const size_t workers = std::min(active.size(), hardware);
+
+            if (1 == workers) {
+              for (auto chunk: active) {
+                visited += drain(chunk, kind);
+              }
+            } else {
+              std::atomic<size_t> next(0);
+              auto work = [&] (void) {
+                size_t mine = 0;
+                for (size_t i = next++; i < active.size(); i = next++) {
+                  mine += drain(active[i], kind);
+                }
+                visited += mine;
+              };
+
+              std::vector<std::thread> pool;
+              for (size_t w = 1; w < workers; w++) {
+                pool.emplace_back(work);
+              }
+              work();
+              for (auto& t: pool) {
+                t.join();
+              }
+
+              threads_used = std::max(threads_used, workers);
+            }
+
+            for (auto chunk: active) {
+              deliver(chunk);
+            }
+          }
+        }
+
+        stats->passes = passes;
+        stats->cells_visited = visited;
+        stats->threads_used = threads_used;
+        stats->relight_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      }
+    }
+  }
+}
@@ -0,0 +1,491 @@
+#include "../trive.hpp"
+
+namespace trive {
+
+  namespace graphics {
+
+    namespace mesh {
+
+      static const GLfloat material_colors[world::material_count][color_dimensions] = {
+        { 0.0f,  0.0f,  0.0f,  0.0f }, // air
+        { 0.5f,  0.5f,  0.55f, 1.0f }, // stone
+        { 0.45f, 0.3f,  0.15f, 1.0f }, // dirt
+        { 0.2f,  0.7f,  0.2f,  1.0f }, // grass
+        { 1.0f,  0.8f,  0.3f,  1.0f }, // torch
+      };
+
+      // how bright a light level looks: a fifth darker per step, but never pitch black
+      static const GLfloat brightness[world::max_light + 1] = {
+        0.112f, 0.120f, 0.131f, 0.143f, 0.159f, 0.179f, 0.203f, 0.234f,
+        0.273f, 0.321f, 0.381f, 0.457f, 0.551f, 0.669f, 0.816f, 1.000f
+      };
+
+      static double ms_since (const std::chrono::steady_clock::time_point& start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      }
+
+      // leave room for a few more faces so small edits can be patched in place
+      static size_t span_capacity (const size_t count) {
+        return ((count + count / 4) / span_granularity + 1) * span_granularity;
+      }
+
+      // which halves of a unit square in an axis plane have a face; the split always runs from its min corner to its max corner
+      static const uint8_t lower_half = 1, upper_half = 2, both_halves = lower_half | upper_half;
+
+      // one bit of grid per run of same-material, same-light faces looking the same way out of the same plane
+      typedef std::map< uint64_t, std::vector<uint8_t> > planes_t;
+
+      static uint64_t plane_key (const uint8_t axis, const int32_t c, const bool facing_up, const uint8_t material, const uint8_t light) {
+        return (((static_cast<uint64_t> (axis) * (world::chunk_size + 1) + static_cast<uint64_t> (c)) * 2 + facing_up) * world::material_count + material) * (world::max_light + 1) + light;
+      }
+
+      // positions are in half units, so a merged face's fan can be centred in the middle of a square
+      static void emit_triangle (const world::chunk_t& chunk, const int32_t tri[3][world::dimensions], const uint8_t material, const uint8_t light, std::vector<vertex_t>* const out) {
+        for (uint8_t v = 0; v < 3; v++) {
+          vertex_t vertex;
+          for (uint8_t d = 0; d < world::dimensions; d++) {
+            const int32_t at = chunk.origin[d] * static_cast<int32_t> (2 * world::chunk_size) + tri[v][d];
+            vertex.position[d] = static_cast<GLfloat> (at) * (vertex_scale / 2) + vertex_offset;
+          }
+          for (uint8_t c = 0; c < 3; c++) {
+            vertex.color[c] = material_colors[material][c] * brightness[light];
+          }
+          vertex.color[3] = material_colors[material][3];
+          out->push_back(vertex);
+        }
+      }
+
+      // a triangle given counter-clockwise in the plane's (u, v), which faces up the plane's axis; flipped if it should face down
+      static void emit_plane_triangle (const world::chunk_t& chunk, const uint8_t axis, const int32_t c, const bool facing_up, const int32_t uv[3][2], const uint8_t material, const uint8_t light, std::vector<vertex_t>* const out) {
+        int32_t tri[3][world::dimensions];
+
+        for (uint8_t v = 0; v < 3; v++) {
+          const uint8_t from = facing_up ? v : static_cast<uint8_t> (2 - v);
+          tri[v][axis] = 2 * c;
+          tri[v][(axis + 1) % world::dimensions] = uv[from][0];
+          tri[v][(axis + 2) % world::dimensions] = uv[from][1];
+        }
+
+        emit_triangle(chunk, tri, material, light, out);
+      }
+
+      // nothing but the faces in this plane can meet at a lattice point in it if every tetrahedron touching the point on
+      // the open side is air and every one on the other side is solid, so merging can drop the point without leaving a crack
+      static bool flat_at (const world::chunk_t& chunk, const uint8_t axis, const int32_t c, const int32_t u, const int32_t v, const bool facing_up) {
+        const uint8_t
+          u_axis = static_cast<uint8_t> ((axis + 1) % world::dimensions),
+          v_axis = static_cast<uint8_t> ((axis + 2) % world::dimensions);
+        int32_t point[world::dimensions], verts[world::tetra_verticies][world::dimensions];
+
+        point[axis] = c;
+        point[u_axis] = u;
+        point[v_axis] = v;
+
+        for (int32_t corner = 0; corner < 8; corner++) {
+          world::cell_t cell;
+          cell.cube[axis] = c - 1 + (corner & 1);
+          cell.cube[u_axis] = u - 1 + ((corner >> 1) & 1);
+          cell.cube[v_axis] = v - 1 + ((corner >> 2) & 1);
+
+          const bool open_side = (1 == (corner & 1)) == facing_up;
+
+          for (uint8_t t = 0; t < world::tetras_per_cube; t++) {
+            cell.t = t;
+            world::cell_verticies(cell, verts);
+
+            bool touches = false;
+            for (uint8_t p = 0; p < world::tetra_verticies; p++) {
+              touches = touches || 0 == std::memcmp(verts[p], point, sizeof point);
+            }
+
+            if (touches && (world::air == chunk.get(cell)) != open_side) {
+              return false;
+            }
+          }
+        }
+
+        return true;
+      }
+
+      // greedily grow rectangles of whole squares and replace each with a fan around its centre through every lattice point on
+      // its border, so whatever meets it there still shares its verticies: fewer triangles, and no T-junctions
+      static void merge_planes (const world::chunk_t& chunk, const int32_t base[world::dimensions], const planes_t& planes, std::vector<vertex_t>* const out) {
+        const int32_t n = static_cast<int32_t> (world::section_size);
+        std::vector<bool> used;
+
+        for (auto& entry: planes) {
+          uint64_t key = entry.first;
+          const uint8_t light = static_cast<uint8_t> (key % (world::max_light + 1));
+          key /= world::max_light + 1;
+          const uint8_t material = static_cast<uint8_t> (key % world::material_count);
+          key /= world::material_count;
+          const bool facing_up = 1 == key % 2;
+          key /= 2;
+          const int32_t c = static_cast<int32_t> (key % (world::chunk_size + 1));
+          const uint8_t axis = static_cast<uint8_t> (key / (world::chunk_size + 1));
+
+          const int32_t
+            base_u = base[(axis + 1) % world::dimensions],
+            base_v = base[(axis + 2) % world::dimensions];
+          const std::vector<uint8_t>& grid = entry.second;
+          used.assign(grid.size(), false);
+
+          for (int32_t v = 0; v < n; v++) {
+            for (int32_t u = 0; u < n; u++) {
+              const size_t at = static_cast<size_t> (v * n + u);
+              if (0 == grid[at] || used[at]) {
+                continue;
+              }
+
+              int32_t w = 1, h = 1;
+
+              if (both_halves == grid[at]) {
+                while (u + w < n && both_halves == grid[at + static_cast<size_t> (w)] && ! used[at + static_cast<size_t> (w)]) {
+                  w++;
+                }
+
+                for (bool grow = true; grow && v + h < n; ) {
+                  for (int32_t i = 0; grow && i < w; i++) {
+                    const size_t next = static_cast<size_t> ((v + h) * n + u + i);
+                    grow = both_halves == grid[next] && ! used[next];
+                  }
+                  // the row boundary being crossed becomes interior
+                  for (int32_t i = 1; grow && i < w; i++) {
+                    grow = flat_at(chunk, axis, c, base_u + u + i, base_v + v + h, facing_up);
+                  }
+                  if (grow) {
+                    h++;
+                  }
+                }
+              }
+
+              for (int32_t j = 0; j < h; j++) {
+                for (int32_t i = 0; i < w; i++) {
+                  used[static_cast<size_t> ((v + j) * n + u + i)] = true;
+                }
+              }
+
+              const int32_t u0 = 2 * (base_u + u), v0 = 2 * (base_v + v);
+
+              // a fan only beats two triangles a square once the rectangle has more inside than around
+              if (w * h > w + h) {
+                std::vector< std::array<int32_t, 2> > ring;
+                for (int32_t i = 0; i < w; i++) { ring.push_back({ { u0 + 2 * i, v0 } }); }
+                for (int32_t j = 0; j < h; j++) { ring.push_back({ { u0 + 2 * w, v0 + 2 * j } }); }
+                for (int32_t i = w; i > 0; i--) { ring.push_back({ { u0 + 2 * i, v0 + 2 * h } }); }
+                for (int32_t j = h; j > 0; j--) { ring.push_back({ { u0, v0 + 2 * j } }); }
+
+                for (size_t r = 0; r < ring.size(); r++) {
+                  const auto& from = ring[r];
+                  const auto& to = ring[(r + 1) % ring.size()];
+                  const int32_t tri[3][2] = { { u0 + w, v0 + h }, { from[0], from[1] }, { to[0], to[1] } };
+                  emit_plane_triangle(chunk, axis, c, facing_up, tri, material, light, out);
+                }
+                continue;
+              }
+
+              for (int32_t j = 0; j < h; j++) {
+                for (int32_t i = 0; i < w; i++) {
+                  const uint8_t halves = grid[static_cast<size_t> ((v + j) * n + u + i)];
+                  const int32_t su = u0 + 2 * i, sv = v0 + 2 * j;
+
+                  if (lower_half & halves) {
+                    const int32_t tri[3][2] = { { su, sv }, { su + 2, sv }, { su + 2, sv + 2 } };
+                    emit_plane_triangle(chunk, axis, c, facing_up, tri, material, light, out);
+                  }
+                  if (upper_half & halves) {
+                    const int32_t tri[3][2] = { { su, sv }, { su + 2, sv + 2 }, { su, sv + 2 } };
+                    emit_plane_triangle(chunk, axis, c, facing_up, tri, material, light, out);
+                  }
+                }
+              }
+            }
+          }
+        }
+      }
+
+      // wind the face counter-clockwise seen from outside, i.e. with the normal facing away from the opposite vertex,
+      // then either put it in its plane's grid for merging or emit it as it is
+      static void emit_face (const world::chunk_t& chunk, const int32_t verts[world::tetra_verticies][world::dimensions], const uint8_t face, const uint8_t material, const uint8_t light, const int32_t base[world::dimensions], planes_t* const planes, std::vector<vertex_t>* const out) {
+        const int32_t* tri[3];
+        uint8_t n = 0;
+        for (uint8_t v = 0; v < world::tetra_verticies; v++) {
+          if (v != face) {
+            tri[n++] = verts[v];
+          }
+        }
+
+        int32_t ab[world::dimensions], ac[world::dimensions], ad[world::dimensions];
+        for (uint8_t d = 0; d < world::dimensions; d++) {
+          ab[d] = tri[1][d] - tri[0][d];
+          ac[d] = tri[2][d] - tri[0][d];
+          ad[d] = verts[face][d] - tri[0][d];
+        }
+        const int32_t facing =
+            (ab[1] * ac[2] - ab[2] * ac[1]) * ad[0]
+          + (ab[2] * ac[0] - ab[0] * ac[2]) * ad[1]
+          + (ab[0] * ac[1] - ab[1] * ac[0]) * ad[2];
+        if (0 < facing) {
+          const int32_t* const swap = tri[1];
+          tri[1] = tri[2];
+          tri[2] = swap;
+        }
+
+        for (uint8_t axis = 0; nullptr != planes && axis < world::dimensions; axis++) {
+          if (tri[0][axis] != tri[1][axis] || tri[0][axis] != tri[2][axis]) {
+            continue;
+          }
+
+          const uint8_t
+            u_axis = static_cast<uint8_t> ((axis + 1) % world::dimensions),
+            v_axis = static_cast<uint8_t> ((axis + 2) % world::dimensions);
+          const int32_t
+            c = tri[0][axis],
+            u0 = std::min(std::min(tri[0][u_axis], tri[1][u_axis]), tri[2][u_axis]),
+            v0 = std::min(std::min(tri[0][v_axis], tri[1][v_axis]), tri[2][v_axis]);
+
+          uint8_t half = upper_half;
+          for (uint8_t v = 0; v < 3; v++) {
+            if (u0 + 1 == tri[v][u_axis] && v0 == tri[v][v_axis]) {
+              half = lower_half;
+            }
+          }
+
+          std::vector<uint8_t>& grid = (*planes)[ plane_key(axis, c, verts[face][axis] < c, material, light) ];
+          grid.resize(world::section_size * world::section_size, 0);
+          grid[ static_cast<size_t> (v0 - base[v_axis]) * world::section_size + static_cast<size_t> (u0 - base[u_axis]) ] |= half;
+          return;
+        }
+
+        int32_t doubled[3][world::dimensions];
+        for (uint8_t v = 0; v < 3; v++) {
+          for (uint8_t d = 0; d < world::dimensions; d++) {
+            doubled[v][d] = 2 * tri[v][d];
+          }
+        }
+        emit_triangle(chunk, doubled, material, light, out);
+      }
+
+      // every face of a solid tetrahedron in the section that looks onto air, lit by that air
+      void mesh_section (const world::chunk_t& chunk, const uint32_t section, const bool merge, std::vector<vertex_t>* const out, merge_stats_t* const stats) {
+        out->clear();
+
+        const int32_t base[world::dimensions] = {
+          static_cast<int32_t> (section % world::sections_per_edge * world::section_size),
+          static_cast<int32_t> (section / (world::sections_per_edge * world::sections_per_edge) * world::section_size),
+          static_cast<int32_t> (section / world::sections_per_edge % world::sections_per_edge * world::section_size)
+        };
+
+        int32_t verts[world::tetra_verticies][world::dimensions];
+        planes_t planes;
+        size_t faces = 0;
+
+        for (uint32_t y = 0; y < world::section_size; y++) {
+          for (uint32_t z = 0; z < world::section_size; z++) {
+            for (uint32_t x = 0; x < world::section_size; x++) {
+              for (uint8_t t = 0; t < world::tetras_per_cube; t++) {
+                const world::cell_t cell = { { base[0] + static_cast<int32_t> (x), base[1] + static_cast<int32_t> (y), base[2] + static_cast<int32_t> (z) }, t };
+                const uint8_t material = chunk.get(cell);
+                if (world::air == material) {
+                  continue;
+                }
+
+                world::cell_verticies(cell, verts);
+                for (uint8_t f = 0; f < world::tetra_faces; f++) {
+                  const world::cell_t n = world::face_neighbor(cell, f);
+                  if (world::air != chunk.get(n)) {
+                    continue;
+                  }
+
+                  const uint8_t light = std::max(chunk.get_light(n, world::block_light), chunk.get_light(n, world::sky_light));
+                  emit_face(chunk, verts, f, material, light, base, merge ? &planes : nullptr, out);
+                  faces++;
+                }
+              }
+            }
+          }
+        }
+
+        if (merge) {
+          const auto start = std::chrono::steady_clock::now();
+          merge_planes(chunk, base, planes, out);
+          if (nullptr != stats) {
+            stats->merge_ms += ms_since(start);
+          }
+        }
+
+        if (nullptr != stats) {
+          stats->faces += faces;
+          stats->triangles += out->size() / 3;
+        }
+      }
+
+      chunk_mesh_t::chunk_mesh_t (const GLuint pos_attr, const GLuint color_attr) noexcept
+        : pos_attr_index(pos_attr), color_attr_index(color_attr),
+          sections(world::chunk_sections), firsts(world::chunk_sections, 0),
+          counts(world::chunk_sections, 0), capacities(world::chunk_sections, 0) { }
+
+      // remesh only the sections the chunk marked dirty and work out which bytes have to go to the GPU;
+      // no GL happens here, that's upload()
+      size_t chunk_mesh_t::update (world::chunk_t* const chunk) {
+        std::vector<uint32_t> dirty;
+        bool edited = false;
+        std::chrono::steady_clock::time_point edited_at;
+
+        if (! chunk->take_dirty(&dirty, &edited, &edited_at)) {
+          return 0;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+
+        merge_stats_t merged;
+        for (auto s: dirty) {
+          mesh_section(*chunk, s, this->merge_coplanar, &this->sections[s], &merged);
+          this->place_span(s);
+        }
+
+        // relocated spans leave holes behind; once they're half the buffer it's time to compact
+        if (this->needs_realloc || 0 == this->buffer_capacity || this->garbage > this->buffer_capacity / 2) {
+          this->defragment();
+        }
+
+        size_t uploaded = 0;
+        if (this->needs_realloc) {
+          uploaded = this->buffer_end;
+        } else {
+          for (auto& u: this->uploads) {
+            uploaded += u.count;
+          }
+        }
+
+        if (edited && ! this->edit_pending) {
+          this->edit_pending = true;
+          this->edit_time = edited_at;
+        }
+
+        this->stats.updates++;
+        this->stats.sections_remeshed = dirty.size();
+        this->stats.bytes_uploaded = nbytes(vertex_t, uploaded);
+        this->stats.bytes_uploaded_total += this->stats.bytes_uploaded;
+        this->stats.remesh_ms = ms_since(start);
+        this->stats.merged = merged;
+
+        return dirty.size();
+      }
+
+      // patch the section where it is if it still fits, move it to the free tail if not, or give up and compact
+      void chunk_mesh_t::place_span (const uint32_t s) {
+        const size_t count = this->sections[s].size();
+        this->counts[s] = static_cast<GLsizei> (count);
+
+        if (this->needs_realloc) {
+          return;
+        }
+
+        if (count > this->capacities[s]) {
+          const size_t capacity = span_capacity(count);
+
+          if (this->buffer_end + capacity > this->buffer_capacity) {
+            this->needs_realloc = true;
+            return;
+          }
+
+          this->garbage += this->capacities[s];
+          this->firsts[s] = static_cast<GLint> (this->buffer_end);
+          this->capacities[s] = capacity;
+          this->buffer_end += capacity;
+        }
+
+        // an earlier update that hasn't been uploaded yet may have queued this section already
+        this->uploads.erase(
+          std::remove_if(this->uploads.begin(), this->uploads.end(), [s] (const upload_t& u) { return u.section == s; }),
+          this->uploads.end()
+        );
+
+        if (0 != count) {
+          this->uploads.push_back({ s, static_cast<size_t> (this->firsts[s]), count });
+        }
+      }
+
+      // lay every section out back to back again with fresh slack, and some headroom at the end for spans that outgrow theirs
+      void chunk_mesh_t::defragment (void) {
+        size_t end = 0;
+        for (uint32_t s = 0; s < world::chunk_sections; s++) {
+          this->firsts[s] = static_cast<GLint> (end);
+          this->capacities[s] = span_capacity(this->sections[s].size());
+          end += this->capacities[s];
+        }
+
+        this->buffer_end = end;
+        this->buffer_capacity = end + end / 4;
+        this->garbage = 0;
+        this->needs_realloc = true;
+        this->uploads.clear();
+      }
+
+      // record the planned uploads; the GL calls happen wherever the list is played back
+      void chunk_mesh_t::upload (renderer::command_list_t* const list) {
+        const auto start = std::chrono::steady_clock::now();
+
+        if (0 == this->vao) {
+          this->vao = renderer::new_handle();
+          this->vbo = renderer::new_handle();
+
+          list->vertex_attrib(this->vao, this->vbo, this->pos_attr_index, space_dimensions, sizeof (vertex_t), offsetof(vertex_t, position));
+          list->vertex_attrib(this->vao, this->vbo, this->color_attr_index, color_dimensions, sizeof (vertex_t), offsetof(vertex_t, color));
+        }
+
+        if (this->needs_realloc) {
+          std::vector<vertex_t> staging(this->buffer_end);
+          for (uint32_t s = 0; s < world::chunk_sections; s++) {
+            std::copy(this->sections[s].begin(), this->sections[s].end(), staging.begin() + this->firsts[s]);
+          }
+
+          list->buffer_data(this->vbo, nbytes(vertex_t, this->buffer_capacity), staging.data(), nbytes(vertex_t, this->buffer_end));
+
+          this->needs_realloc = false;
+          this->stats.reallocations++;
+        } else {
+          for (auto& u: this->uploads) {
+            list->buffer_sub_data(this->vbo, nbytes(vertex_t, u.first), this->sections[u.section].data(), nbytes(vertex_t, u.count));
+          }
+        }
+
+        this->uploads.clear();
+
+        this->stats.upload_ms = ms_since(start);
+      }
+
+      void chunk_mesh_t::draw (renderer::command_list_t* const list) {
+        list->multi_draw(this->vao, GL_TRIANGLES, this->firsts.data(), this->counts.data(), world::chunk_sections);
+      }
+
+      // call once the frame that drew the last upload has been swapped
+      void chunk_mesh_t::note_visible (void) {
+        if (this->edit_pending) {
+          this->stats.edit_to_visible_ms = ms_since(this->edit_time);
+          this->edit_pending = false;
+        }
+      }
+
+      void chunk_mesh_t::print_stats (void) {
+        std::printf(
+          "mesh: %zu sections remeshed in %.3f ms, %zu bytes queued for upload in %.3f ms, edit to visible %.3f ms (%" PRIu64 " bytes, %" PRIu64 " reallocations over %" PRIu64 " updates)\n",
+          this->stats.sections_remeshed, this->stats.remesh_ms,
+          this->stats.bytes_uploaded, this->stats.upload_ms,
+          this->stats.edit_to_visible_ms,
+          this->stats.bytes_uploaded_total, this->stats.reallocations, this->stats.updates
+        );
+
+        if (this->merge_coplanar && 0 != this->stats.merged.faces) {
+          std::printf(
+            "mesh: %zu faces merged down to %zu triangles (%.1f%%) in %.3f ms\n",
+            this->stats.merged.faces, this->stats.merged.triangles,
+            100.0 * static_cast<double> (this->stats.merged.triangles) / static_cast<double> (this->stats.merged.faces),
+            this->stats.merged.merge_ms
+          );
+        }
+      }
+    }
+  }
+}
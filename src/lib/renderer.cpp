@@ -0,0 +1,355 @@
+#include "../trive.hpp"
+
+namespace trive {
+
+  namespace graphics {
+
+    namespace renderer {
+
+      static uint64_t ns_since (const std::chrono::steady_clock::time_point& start) {
+        return static_cast<uint64_t> (std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+      }
+
+      // a few yields in case the other side is about to finish, then short sleeps so a thread waiting out a vsync'd swap
+      // doesn't hold on to a core the rasterizer could use
+      static const uint32_t spins_before_sleeping = 64;
+      static const std::chrono::microseconds wait_sleep(100);
+
+      static void back_off (uint32_t* const spins) {
+        if (spins_before_sleeping > *spins) {
+          (*spins)++;
+          std::this_thread::yield();
+        } else {
+          std::this_thread::sleep_for(wait_sleep);
+        }
+      }
+
+      uint32_t new_handle (void) {
+        static std::atomic<uint32_t> next(1);
+        return next++;
+      }
+
+      // payload entries start on 8-byte boundaries
+      size_t padded (const size_t size) {
+        return ((size + 7) / 8) * 8;
+      }
+
+      void command_list_t::reset (void) {
+        this->commands.clear();
+        this->payload.clear();
+      }
+
+      // kept aligned so the executor can point GL straight at it
+      size_t command_list_t::push_payload (const void* const data, const size_t size) {
+        const size_t at = this->payload.size();
+        this->payload.resize(at + padded(size));
+        std::memcpy(this->payload.data() + at, data, size);
+        return at;
+      }
+
+      void command_list_t::clear (const GLfloat* const color) {
+        command_t command = command_t();
+        command.kind = cmd_clear;
+        command.data_size = nbytes(GLfloat, color_dimensions);
+        command.data = this->push_payload(color, command.data_size);
+        this->commands.push_back(command);
+      }
+
+      void command_list_t::use_program (const GLuint program) {
+        command_t command = command_t();
+        command.kind = cmd_use_program;
+        command.object = program;
+        this->commands.push_back(command);
+      }
+
+      // (re)allocates the whole buffer, then fills it from the start with data_size bytes of data if there are any
+      void command_list_t::buffer_data (const uint32_t buffer, const uint64_t size, const void* const data, const size_t data_size) {
+        command_t command = command_t();
+        command.kind = cmd_buffer_data;
+        command.buffer = buffer;
+        command.count = GL_DYNAMIC_DRAW;
+        command.size = size;
+        command.data_size = data_size;
+        if (0 != data_size) {
+          command.data = this->push_payload(data, data_size);
+        }
+        this->commands.push_back(command);
+      }
+
+      void command_list_t::buffer_sub_data (const uint32_t buffer, const uint64_t offset, const void* const data, const size_t size) {
+        command_t command = command_t();
+        command.kind = cmd_buffer_sub_data;
+        command.buffer = buffer;
+        command.offset = offset;
+        command.size = size;
+        command.data_size = size;
+        command.data = this->push_payload(data, size);
+        this->commands.push_back(command);
+      }
+
+      // float attribute `index` of the vertex array, read from the buffer
+      void command_list_t::vertex_attrib (const uint32_t array, const uint32_t buffer, const uint32_t index, const uint32_t components, const uint64_t stride, const uint64_t offset) {
+        command_t command = command_t();
+        command.kind = cmd_vertex_attrib;
+        command.object = array;
+        command.buffer = buffer;
+        command.index = index;
+        command.count = components;
+        command.size = stride;
+        command.offset = offset;
+        this->commands.push_back(command);
+      }
+
+      void command_list_t::multi_draw (const uint32_t array, const GLenum mode, const GLint* const firsts, const GLsizei* const counts, const uint32_t spans) {
+        command_t command = command_t();
+        command.kind = cmd_multi_draw;
+        command.object = array;
+        command.index = mode;
+        command.count = spans;
+        command.data_size = nbytes(GLint, spans) + nbytes(GLsizei, spans);
+        command.data = this->push_payload(firsts, nbytes(GLint, spans));
+        this->push_payload(counts, nbytes(GLsizei, spans));
+        this->commands.push_back(command);
+      }
+
+      void command_list_t::swap (void) {
+        command_t command = command_t();
+        command.kind = cmd_swap;
+        this->commands.push_back(command);
+      }
+
+      executor_t::executor_t (SDL_Window* const win) noexcept : window(win) { }
+
+      executor_t::~executor_t (void) noexcept {
+        this->release();
+      }
+
+      // the GL name behind a handle, made the first time it's used
+      GLuint executor_t::buffer (const uint32_t handle) {
+        GLuint& name = this->buffers[handle];
+        if (0 == name) {
+          glGenBuffers(1, &name);
+        }
+        return name;
+      }
+
+      GLuint executor_t::array (const uint32_t handle) {
+        GLuint& name = this->arrays[handle];
+        if (0 == name) {
+          glGenVertexArrays(1, &name);
+        }
+        return name;
+      }
+
+      GLuint executor_t::program (const GLuint name) {
+        const auto found = this->programs.find(name);
+        return this->programs.end() == found ? name : found->second;
+      }
+
+      void executor_t::execute (const command_list_t& list) {
+        const uint8_t* const payload = list.payload.data();
+
+        for (auto& command: list.commands) {
+          switch (command.kind) {
+            case cmd_clear: {
+              const GLfloat* const color = reinterpret_cast<const GLfloat*> (payload + command.data);
+              glClearColor(color[0], color[1], color[2], color[3]);
+              glClear(GL_COLOR_BUFFER_BIT);
+              break;
+            }
+
+            case cmd_use_program: {
+              glUseProgram(this->program(command.object));
+              break;
+            }
+
+            case cmd_buffer_data: {
+              glBindBuffer(GL_ARRAY_BUFFER, this->buffer(command.buffer));
+              glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr> (command.size), nullptr, command.count);
+              if (0 != command.data_size) {
+                glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr> (command.data_size), payload + command.data);
+              }
+              glBindBuffer(GL_ARRAY_BUFFER, 0);
+              break;
+            }
+
+            case cmd_buffer_sub_data: {
+              glBindBuffer(GL_ARRAY_BUFFER, this->buffer(command.buffer));
+              glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr> (command.offset), static_cast<GLsizeiptr> (command.size), payload + command.data);
+              glBindBuffer(GL_ARRAY_BUFFER, 0);
+              break;
+            }
+
+            case cmd_vertex_attrib: {
+              glBindVertexArray(this->array(command.object));
+              glBindBuffer(GL_ARRAY_BUFFER, this->buffer(command.buffer));
+              glVertexAttribPointer(command.index, static_cast<GLint> (command.count), GL_FLOAT, GL_FALSE, static_cast<GLsizei> (command.size), reinterpret_cast<const GLvoid*> (command.offset));
+              glEnableVertexAttribArray(command.index);
+              glBindBuffer(GL_ARRAY_BUFFER, 0);
+              break;
+            }
+
+            case cmd_multi_draw: {
+              const GLint* const firsts = reinterpret_cast<const GLint*> (payload + command.data);
+              const GLsizei* const counts = reinterpret_cast<const GLsizei*> (payload + command.data + padded(nbytes(GLint, command.count)));
+              glBindVertexArray(this->array(command.object));
+              glMultiDrawArrays(command.index, firsts, counts, static_cast<GLsizei> (command.count));
+              break;
+            }
+
+            case cmd_swap: {
+              SDL_GL_SwapWindow(this->window);
+              break;
+            }
+
+            default: {
+              std::fprintf(stderr, "%s: unknown command %u\n", __func__, command.kind);
+              break;
+            }
+          }
+        }
+      }
+
+      // must run where the context is current
+      void executor_t::release (void) {
+        for (auto& mapped: this->arrays) {
+          glDeleteVertexArrays(1, &mapped.second);
+        }
+        for (auto& mapped: this->buffers) {
+          glDeleteBuffers(1, &mapped.second);
+        }
+
+        for (auto& mapped: this->programs) {
+          glDeleteProgram(mapped.second);
+        }
+
+        this->arrays.clear();
+        this->buffers.clear();
+        this->programs.clear();
+      }
+
+      thread_timing_t::thread_timing_t (void) noexcept : busy_ns(0), wait_ns(0), last_busy_ns(0) { }
+
+      render_thread_t::render_thread_t (SDL_Window* const win, SDL_GLContext ctx) noexcept
+        : window(win), context(ctx), submitted(0), consumed(0), running(false), capture_ns(0) { }
+
+      render_thread_t::~render_thread_t (void) noexcept {
+        this->stop();
+      }
+
+      // hands the context over; the calling thread mustn't touch GL until stop()
+      void render_thread_t::start (void) {
+        SDL_GL_MakeCurrent(this->window, nullptr);
+
+        this->running = true;
+        this->started = std::chrono::steady_clock::now();
+        this->thread = std::thread(&render_thread_t::loop, this);
+      }
+
+      // lets the render thread finish what was submitted, then takes the context back
+      void render_thread_t::stop (void) {
+        if (! this->thread.joinable()) {
+          return;
+        }
+
+        this->running = false;
+        this->thread.join();
+
+        SDL_GL_MakeCurrent(this->window, this->context);
+      }
+
+      // simulation thread: the list for frame N is free once frame N - 2 has been played, so this only waits when it's two frames ahead
+      command_list_t* render_thread_t::begin_frame (void) {
+        const auto start = std::chrono::steady_clock::now();
+        const uint64_t frame = this->submitted.load(std::memory_order_relaxed);
+
+        uint32_t spins = 0;
+        while (this->consumed.load(std::memory_order_acquire) + 1 < frame) {
+          back_off(&spins);
+        }
+
+        this->simulation.wait_ns += ns_since(start);
+        this->frame_started = std::chrono::steady_clock::now();
+
+        command_list_t* const list = &this->lists[frame % 2];
+        list->reset();
+        return list;
+      }
+
+      void render_thread_t::submit (void) {
+        const uint64_t busy = ns_since(this->frame_started);
+        this->simulation.busy_ns += busy;
+        this->simulation.last_busy_ns = busy;
+
+        this->submitted.fetch_add(1, std::memory_order_release);
+      }
+
+      void render_thread_t::loop (void) {
+        SDL_GL_MakeCurrent(this->window, this->context);
+
+        executor_t executor(this->window);
+        auto idle_since = std::chrono::steady_clock::now();
+        uint32_t spins = 0;
+
+        while (this->running.load() || this->consumed.load() < this->submitted.load()) {
+          const uint64_t frame = this->consumed.load(std::memory_order_relaxed);
+
+          if (frame == this->submitted.load(std::memory_order_acquire)) {
+            back_off(&spins);
+            continue;
+          }
+          spins = 0;
+
+          this->render.wait_ns += ns_since(idle_since);
+
+          // writing the capture is kept out of render time so capturing doesn't skew what it records
+          if (nullptr != this->capture) {
+            const auto capture_start = std::chrono::steady_clock::now();
+            this->capture->frame(this->lists[frame % 2]);
+            this->capture_ns += ns_since(capture_start);
+          }
+
+          const auto start = std::chrono::steady_clock::now();
+
+          executor.execute(this->lists[frame % 2]);
+
+          const uint64_t busy = ns_since(start);
+          this->render.busy_ns += busy;
+          this->render.last_busy_ns = busy;
+
+          idle_since = std::chrono::steady_clock::now();
+          this->consumed.store(frame + 1, std::memory_order_release);
+        }
+
+        executor.release();
+        SDL_GL_MakeCurrent(this->window, nullptr);
+      }
+
+      // whatever the two threads were busy for beyond the wall clock, they spent busy at the same time
+      void render_thread_t::print_timing (void) {
+        const uint64_t frames = this->consumed.load();
+        if (0 == frames) {
+          return;
+        }
+
+        const double
+          per_frame = 1e6 * static_cast<double> (frames),
+          wall = static_cast<double> (ns_since(this->started)) / per_frame,
+          sim_busy = static_cast<double> (this->simulation.busy_ns.load()) / per_frame,
+          sim_wait = static_cast<double> (this->simulation.wait_ns.load()) / per_frame,
+          render_busy = static_cast<double> (this->render.busy_ns.load()) / per_frame,
+          render_wait = static_cast<double> (this->render.wait_ns.load()) / per_frame,
+          capturing = static_cast<double> (this->capture_ns.load()) / per_frame;
+
+        std::printf(
+          "%" PRIu64 " frames, %.3f ms each: simulation %.3f ms busy + %.3f ms waiting, render %.3f ms busy + %.3f ms waiting, overlapping %.3f ms\n",
+          frames, wall, sim_busy, sim_wait, render_busy, render_wait, std::max(0.0, sim_busy + render_busy - wall)
+        );
+
+        if (nullptr != this->capture) {
+          std::printf("render thread also spent %.3f ms a frame writing the capture\n", capturing);
+        }
+      }
+    }
+  }
+}
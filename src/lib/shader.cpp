@@ -65,6 +65,7 @@ namespace trive {
         // Bind attribute index 0 (coordinates) to in_Position and attribute index 1 (color) to in_Color
         // Attribute locations must be setup before calling glLinkProgram
         glBindAttribLocation(this->shader_program, index, attribute);
+        this->attributes.push_back({ index, attribute });
       }
 
 /*
@@ -177,6 +178,7 @@ namespace trive {
           const GLuint shader_id = glCreateShader(shader_type);
 
           glShaderSource(shader_id , 1, &shader_source, &shader_len);
+          this->stages.push_back({ shader_type, std::string(shader_source, static_cast<size_t> (shader_len)) });
           free(shader_source);
 
           return shader_id;
@@ -0,0 +1,345 @@
+#include "../trive.hpp"
+
+namespace trive {
+
+  namespace world {
+
+    // Kuhn triangulation: tetrahedron t walks from its cube's min corner to its max corner along the axes in this order,
+    // which makes every face line up with exactly one face of one other tetrahedron, even across cubes
+    static const uint8_t axis_orders[tetras_per_cube][dimensions] = {
+      { 0, 1, 2 }, { 0, 2, 1 }, { 1, 0, 2 }, { 1, 2, 0 }, { 2, 0, 1 }, { 2, 1, 0 }
+    };
+
+    static uint8_t order_to_tetra (const uint8_t a, const uint8_t b, const uint8_t c) {
+      for (uint8_t t = 0; t < tetras_per_cube; t++) {
+        if (axis_orders[t][0] == a && axis_orders[t][1] == b && axis_orders[t][2] == c) {
+          return t;
+        }
+      }
+      return 0;
+    }
+
+    void cell_verticies (const cell_t& cell, int32_t out[tetra_verticies][dimensions]) {
+      int32_t at[dimensions] = { cell.cube[0], cell.cube[1], cell.cube[2] };
+
+      for (uint8_t v = 0; v < tetra_verticies; v++) {
+        if (0 != v) {
+          at[ axis_orders[cell.t][v - 1] ] += 1;
+        }
+        std::memcpy(out[v], at, sizeof at);
+      }
+    }
+
+    // the tetrahedron on the other side of the face opposite vertex `face`
+    cell_t face_neighbor (const cell_t& cell, const uint8_t face) {
+      const uint8_t* const order = axis_orders[cell.t];
+      cell_t out = cell;
+
+      switch (face) {
+        // the two middle faces swap a pair of steps and stay in the same cube
+        case 1: {
+          out.t = order_to_tetra(order[1], order[0], order[2]);
+          break;
+        }
+        case 2: {
+          out.t = order_to_tetra(order[0], order[2], order[1]);
+          break;
+        }
+        // the faces opposite the min and max corners are shared with the next and previous cubes
+        case 0: {
+          out.cube[ order[0] ] += 1;
+          out.t = order_to_tetra(order[1], order[2], order[0]);
+          break;
+        }
+        default: {
+          out.cube[ order[2] ] -= 1;
+          out.t = order_to_tetra(order[2], order[0], order[1]);
+          break;
+        }
+      }
+
+      return out;
+    }
+
+    static double terrain_height (const int32_t x, const int32_t z) {
+      return (chunk_size / 3.0)
+        + 3.0 * std::sin(x * 0.15) * std::cos(z * 0.11)
+        + 1.5 * std::sin((x + z) * 0.05);
+    }
+
+    chunk_t::chunk_t (const int32_t x, const int32_t y, const int32_t z) noexcept
+      : materials(chunk_cells, air), dirty_sections(chunk_sections, false) {
+      for (uint8_t ch = 0; ch < light_channels; ch++) {
+        this->light[ch].assign(chunk_cells, 0);
+      }
+
+      this->origin[0] = x;
+      this->origin[1] = y;
+      this->origin[2] = z;
+
+      // nothing has been meshed yet
+      this->mark_all_dirty();
+    }
+
+    bool chunk_t::contains (const cell_t& cell) {
+      for (uint8_t d = 0; d < dimensions; d++) {
+        if (0 > cell.cube[d] || static_cast<int32_t> (chunk_size) <= cell.cube[d]) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    uint32_t chunk_t::cell_index (const cell_t& cell) {
+      const uint32_t
+        x = static_cast<uint32_t> (cell.cube[0]),
+        y = static_cast<uint32_t> (cell.cube[1]),
+        z = static_cast<uint32_t> (cell.cube[2]);
+
+      return ((y * chunk_size + z) * chunk_size + x) * tetras_per_cube + cell.t;
+    }
+
+    uint32_t chunk_t::section_index (const cell_t& cell) {
+      const uint32_t
+        x = static_cast<uint32_t> (cell.cube[0]) / section_size,
+        y = static_cast<uint32_t> (cell.cube[1]) / section_size,
+        z = static_cast<uint32_t> (cell.cube[2]) / section_size;
+
+      return (y * sections_per_edge + z) * sections_per_edge + x;
+    }
+
+    cell_t chunk_t::index_cell (const uint32_t index) {
+      const uint32_t cube = index / tetras_per_cube;
+      const cell_t cell = { {
+        static_cast<int32_t> (cube % chunk_size),
+        static_cast<int32_t> (cube / (chunk_size * chunk_size)),
+        static_cast<int32_t> (cube / chunk_size % chunk_size)
+      }, static_cast<uint8_t> (index % tetras_per_cube) };
+
+      return cell;
+    }
+
+    // rewrites a cell that lies outside this chunk to be local to whichever chunk it's really in, or null if there's none loaded
+    chunk_t* chunk_t::resolve (cell_t* const cell) const {
+      chunk_t* at = const_cast<chunk_t*> (this);
+
+      for (uint8_t d = 0; d < dimensions && nullptr != at; d++) {
+        if (0 > cell->cube[d]) {
+          at = at->neighbors[2 * d];
+          cell->cube[d] += static_cast<int32_t> (chunk_size);
+        } else if (static_cast<int32_t> (chunk_size) <= cell->cube[d]) {
+          at = at->neighbors[2 * d + 1];
+          cell->cube[d] -= static_cast<int32_t> (chunk_size);
+        }
+      }
+
+      return at;
+    }
+
+    uint8_t chunk_t::get (const cell_t& cell) const {
+      cell_t local = cell;
+      const chunk_t* const owner = this->resolve(&local);
+
+      if (nullptr == owner) {
+        return air;
+      }
+      return owner->materials[ cell_index(local) ];
+    }
+
+    // the highest non-air first tetrahedron of a cube column, or the bottom one if it's all air
+    cell_t chunk_t::top_solid (const int32_t x, const int32_t z) const {
+      cell_t cell = { { x, static_cast<int32_t> (chunk_size) - 1, z }, 0 };
+      while (0 < cell.cube[1] && air == this->get(cell)) {
+        cell.cube[1]--;
+      }
+      return cell;
+    }
+
+    uint8_t chunk_t::get_light (const cell_t& cell, const uint8_t channel) const {
+      cell_t local = cell;
+      const chunk_t* const owner = this->resolve(&local);
+
+      if (nullptr == owner) {
+        // nothing loaded out there, so nothing to block the sky either
+        return sky_light == channel ? max_light : 0;
+      }
+      return owner->light[channel][ cell_index(local) ];
+    }
+
+    // returns whether anything changed; the cell and its face neighbors need remeshing if so
+    bool chunk_t::set (const cell_t& cell, const uint8_t material) {
+      if (! contains(cell) || material == this->materials[ cell_index(cell) ]) {
+        return false;
+      }
+
+      this->materials[ cell_index(cell) ] = material;
+
+      if (! this->edit_pending) {
+        this->edit_pending = true;
+        this->edit_time = std::chrono::steady_clock::now();
+      }
+
+      this->mark_dirty(cell);
+      for (uint8_t f = 0; f < tetra_faces; f++) {
+        this->mark_dirty(face_neighbor(cell, f));
+      }
+
+      return true;
+    }
+
+    void chunk_t::generate_terrain (void) {
+      int32_t verts[tetra_verticies][dimensions];
+
+      for (int32_t y = 0; y < static_cast<int32_t> (chunk_size); y++) {
+        for (int32_t z = 0; z < static_cast<int32_t> (chunk_size); z++) {
+          for (int32_t x = 0; x < static_cast<int32_t> (chunk_size); x++) {
+            const int32_t
+              wx = this->origin[0] * static_cast<int32_t> (chunk_size) + x,
+              wy = this->origin[1] * static_cast<int32_t> (chunk_size) + y,
+              wz = this->origin[2] * static_cast<int32_t> (chunk_size) + z;
+            const double height = terrain_height(wx, wz);
+
+            for (uint8_t t = 0; t < tetras_per_cube; t++) {
+              const cell_t cell = { { x, y, z }, t };
+              cell_verticies(cell, verts);
+
+              // decide by the centroid so slopes come out as slanted tetrahedron faces instead of stairs
+              const double centroid_y = wy + (verts[0][1] + verts[1][1] + verts[2][1] + verts[3][1] - 4 * y) / 4.0;
+              const double depth = height - centroid_y;
+
+              uint8_t material = air;
+              if (4.0 < depth) {
+                material = stone;
+              } else if (1.0 < depth) {
+                material = dirt;
+              } else if (0.0 < depth) {
+                material = grass;
+              }
+
+              this->materials[ cell_index(cell) ] = material;
+            }
+          }
+        }
+      }
+
+      this->mark_all_dirty();
+    }
+
+    // faces on a chunk border belong to the chunk on the other side too
+    void chunk_t::mark_dirty (const cell_t& cell) {
+      cell_t local = cell;
+      chunk_t* const owner = this->resolve(&local);
+
+      if (nullptr == owner) {
+        return;
+      }
+
+      const uint32_t section = section_index(local);
+      if (! owner->dirty_sections[section]) {
+        owner->dirty_sections[section] = true;
+        owner->dirty_list.push_back(section);
+      }
+    }
+
+    void chunk_t::mark_all_dirty (void) {
+      this->dirty_list.clear();
+      for (uint32_t s = 0; s < chunk_sections; s++) {
+        this->dirty_sections[s] = true;
+        this->dirty_list.push_back(s);
+      }
+    }
+
+    // hands over the dirty sections and when the oldest pending edit happened, if there was one
+    bool chunk_t::take_dirty (std::vector<uint32_t>* const out, bool* const edited, std::chrono::steady_clock::time_point* const edit_at) {
+      if (this->dirty_list.empty()) {
+        return false;
+      }
+
+      out->swap(this->dirty_list);
+      this->dirty_list.clear();
+      for (auto s: *out) {
+        this->dirty_sections[s] = false;
+      }
+
+      set_out_param(edited, this->edit_pending);
+      set_out_param(edit_at, this->edit_time);
+      this->edit_pending = false;
+
+      return true;
+    }
+
+    world_t::world_t (const int32_t x, const int32_t y, const int32_t z) noexcept {
+      this->size[0] = x;
+      this->size[1] = y;
+      this->size[2] = z;
+
+      for (int32_t cy = 0; cy < y; cy++) {
+        for (int32_t cz = 0; cz < z; cz++) {
+          for (int32_t cx = 0; cx < x; cx++) {
+            this->chunks.push_back(new chunk_t(cx, cy, cz));
+          }
+        }
+      }
+
+      for (auto chunk: this->chunks) {
+        for (uint8_t d = 0; d < dimensions; d++) {
+          int32_t at[dimensions] = { chunk->origin[0], chunk->origin[1], chunk->origin[2] };
+
+          at[d] -= 1;
+          chunk->neighbors[2 * d] = this->chunk_at(at[0], at[1], at[2]);
+          at[d] += 2;
+          chunk->neighbors[2 * d + 1] = this->chunk_at(at[0], at[1], at[2]);
+        }
+      }
+    }
+
+    world_t::~world_t (void) noexcept {
+      for (auto chunk: this->chunks) {
+        delete chunk;
+      }
+    }
+
+    chunk_t* world_t::chunk_at (const int32_t x, const int32_t y, const int32_t z) const {
+      if (0 > x || 0 > y || 0 > z || this->size[0] <= x || this->size[1] <= y || this->size[2] <= z) {
+        return nullptr;
+      }
+
+      const size_t index = static_cast<size_t> ((y * this->size[2] + z) * this->size[0] + x);
+      return this->chunks[index];
+    }
+
+    void world_t::generate_terrain (void) {
+      for (auto chunk: this->chunks) {
+        chunk->generate_terrain();
+      }
+
+      for (auto chunk: this->chunks) {
+        light::seed(chunk);
+      }
+
+      this->relight();
+    }
+
+    // queues the light changes an edit causes; call relight() once the edits for this tick are done
+    bool world_t::set (chunk_t* const chunk, const cell_t& cell, const uint8_t material) {
+      if (! chunk->set(cell, material)) {
+        return false;
+      }
+
+      light::on_edit(chunk, cell);
+      return true;
+    }
+
+    void world_t::relight (void) {
+      light::propagate(this->chunks, &this->light_stats);
+    }
+
+    void world_t::print_light_stats (void) {
+      std::printf(
+        "light: %zu cells visited in %zu passes on %zu threads, %.3f ms\n",
+        this->light_stats.cells_visited, this->light_stats.passes,
+        this->light_stats.threads_used, this->light_stats.relight_ms
+      );
+    }
+  }
+}
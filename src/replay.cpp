@@ -0,0 +1,109 @@
+#include "trive.hpp"
+
+// replay <capture> [passes]
+// plays a capture back in a hidden window with vsync off, waiting for the GPU after every frame so each one is timed on
+// its own; SDL_VIDEODRIVER picks where the window lives on a box without a display
+auto main (const int argc, char* const * const argv) -> int {
+  using namespace trive::graphics::renderer;
+
+  if (2 > argc) {
+    std::fprintf(stderr, "usage: %s <capture> [passes]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  const long passes = 3 > argc ? 1 : std::max(1L, std::strtol(argv[2], nullptr, 10));
+
+  capture_t capture;
+  FILE* const capture_fp = std::fopen(argv[1], "rb");
+
+  if (nullptr == capture_fp) {
+    std::fprintf(stderr, "%s: %s: %s\n", argv[0], argv[1], strerror(errno));
+    return EXIT_FAILURE;
+  }
+
+  const bool read = read_capture(capture_fp, &capture);
+  std::fclose(capture_fp);
+
+  if (! read || capture.frames.empty()) {
+    std::fprintf(stderr, "%s: %s: nothing to replay\n", argv[0], argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  if ( 0 > SDL_Init(SDL_INIT_VIDEO) || ! trive::graphics::metadata::set_opengl_attributes(4, 6) ) {
+    check_sdl_error();
+    return EXIT_FAILURE;
+  }
+
+  SDL_Window* const window = SDL_CreateWindow(
+    trive::program_name,
+    SDL_WINDOWPOS_CENTERED,
+    SDL_WINDOWPOS_CENTERED,
+    static_cast<int> (capture.width), static_cast<int> (capture.height),
+    SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN
+  );
+
+  SDL_GLContext context = nullptr;
+  if ( nullptr == window || nullptr == (context = SDL_GL_CreateContext(window)) ) {
+    check_sdl_error();
+    return EXIT_FAILURE;
+  }
+
+  SDL_GL_SetSwapInterval(0);
+
+  std::vector<double> frame_ms;
+  size_t commands = 0;
+
+  for (auto& list: capture.frames) {
+    commands += list.commands.size();
+  }
+
+  {
+    executor_t executor(window);
+
+    // every pass starts from a fresh program and fresh buffers, as the capture did
+    for (long pass = 0; pass < passes; pass++) {
+      for (auto& prog: capture.programs) {
+        const GLuint name = build_program(prog);
+        if (0 == name) {
+          return EXIT_FAILURE;
+        }
+        executor.programs[prog.name] = name;
+      }
+
+      for (auto& list: capture.frames) {
+        const auto start = std::chrono::steady_clock::now();
+
+        executor.execute(list);
+        glFinish();
+
+        frame_ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+      }
+
+      executor.release();
+    }
+  }
+
+  for (size_t i = 0; i < frame_ms.size(); i++) {
+    std::printf("frame %zu: %.3f ms\n", i, frame_ms[i]);
+  }
+
+  std::vector<double> sorted = frame_ms;
+  std::sort(sorted.begin(), sorted.end());
+
+  double total = 0;
+  for (auto ms: frame_ms) {
+    total += ms;
+  }
+
+  std::printf(
+    "%zu frames over %ld passes (%zu commands per pass): %.3f ms total, min %.3f, median %.3f, mean %.3f, max %.3f ms\n",
+    frame_ms.size(), passes, commands,
+    total, sorted.front(), sorted[sorted.size() / 2], total / static_cast<double> (frame_ms.size()), sorted.back()
+  );
+
+  SDL_GL_DeleteContext(context);
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+
+  return EXIT_SUCCESS;
+}
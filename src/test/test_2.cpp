@@ -0,0 +1,104 @@
+#include <criterion/criterion.h>
+#include "../trive.hpp"
+
+using namespace trive::world;
+using namespace trive::graphics::mesh;
+
+Test(world, face_neighbors_agree) {
+  int32_t mine[tetra_verticies][dimensions], theirs[tetra_verticies][dimensions];
+
+  for (uint8_t t = 0; t < tetras_per_cube; t++) {
+    const cell_t cell = { { 1, 1, 1 }, t };
+    cell_verticies(cell, mine);
+
+    for (uint8_t f = 0; f < tetra_faces; f++) {
+      const cell_t other = face_neighbor(cell, f);
+      cell_verticies(other, theirs);
+
+      // the three verticies of the face are shared, and exactly one of the neighbor's faces leads back
+      uint32_t shared = 0, back = 0;
+      for (uint8_t a = 0; a < tetra_verticies; a++) {
+        for (uint8_t b = 0; b < tetra_verticies; b++) {
+          shared += (0 == std::memcmp(mine[a], theirs[b], sizeof mine[a]));
+        }
+      }
+      for (uint8_t g = 0; g < tetra_faces; g++) {
+        const cell_t round_trip = face_neighbor(other, g);
+        back += (0 == std::memcmp(round_trip.cube, cell.cube, sizeof cell.cube) && round_trip.t == cell.t);
+      }
+
+      cr_assert_eq(shared, 3u);
+      cr_assert_eq(back, 1u);
+    }
+  }
+}
+
+Test(world, edit_marks_only_touched_sections) {
+  chunk_t chunk(0, 0, 0);
+  std::vector<uint32_t> dirty;
+  cr_assert(chunk.take_dirty(&dirty, nullptr, nullptr));
+  cr_assert_eq(dirty.size(), chunk_sections);
+
+  const cell_t middle = { { 3, 3, 3 }, 0 };
+  cr_assert(chunk.set(middle, stone));
+  cr_assert(chunk.take_dirty(&dirty, nullptr, nullptr));
+  cr_assert_eq(dirty.size(), 1);
+
+  // a cell in the section corner can reach into the next section over
+  const cell_t corner = { { section_size - 1, 0, 0 }, 0 };
+  cr_assert(chunk.set(corner, stone));
+  cr_assert(chunk.take_dirty(&dirty, nullptr, nullptr));
+  cr_assert_eq(dirty.size(), 2);
+
+  cr_assert_not(chunk.set(corner, stone));
+  cr_assert_not(chunk.take_dirty(&dirty, nullptr, nullptr));
+}
+
+Test(mesh, edit_patches_in_place) {
+  chunk_t chunk(0, 0, 0);
+  chunk.generate_terrain();
+
+  chunk_mesh_t chunk_mesh(0, 1);
+  cr_assert_eq(chunk_mesh.update(&chunk), chunk_sections);
+  cr_assert(chunk_mesh.needs_realloc);
+  const size_t full_bytes = chunk_mesh.stats.bytes_uploaded;
+  chunk_mesh.needs_realloc = false;
+
+  const cell_t dig = chunk.top_solid(4, 4);
+
+  const GLint before = chunk_mesh.firsts[ chunk_t::section_index(dig) ];
+  cr_assert(chunk.set(dig, air));
+  cr_assert_leq(chunk_mesh.update(&chunk), 3);
+  cr_assert_not(chunk_mesh.needs_realloc);
+  cr_assert_eq(chunk_mesh.firsts[ chunk_t::section_index(dig) ], before);
+  cr_assert_gt(chunk_mesh.stats.bytes_uploaded, 0);
+  cr_assert_lt(chunk_mesh.stats.bytes_uploaded * 8, full_bytes);
+}
+
+Test(mesh, outgrown_span_moves_then_compacts) {
+  chunk_t chunk(0, 0, 0);
+  chunk_mesh_t chunk_mesh(0, 1);
+  chunk_mesh.update(&chunk);
+  chunk_mesh.needs_realloc = false;
+
+  // a checkerboard of lone tetrahedra has far more faces than an empty section has room for
+  for (int32_t y = 0; y < 2; y++) {
+    for (int32_t z = 0; z < 2; z++) {
+      for (int32_t x = 0; x < 2; x++) {
+        const cell_t cell = { { 2 * x, 2 * y, 2 * z }, 0 };
+        chunk.set(cell, stone);
+      }
+    }
+  }
+
+  const size_t end_before = chunk_mesh.buffer_end;
+  chunk_mesh.update(&chunk);
+  cr_assert_not(chunk_mesh.needs_realloc);
+  cr_assert_eq(static_cast<size_t> (chunk_mesh.firsts[0]), end_before);
+  cr_assert_eq(chunk_mesh.uploads.size(), 1);
+
+  chunk.generate_terrain();
+  chunk_mesh.update(&chunk);
+  cr_assert(chunk_mesh.needs_realloc);
+  cr_assert_eq(chunk_mesh.garbage, 0);
+}
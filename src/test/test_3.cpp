@@ -0,0 +1,98 @@
+#include <criterion/criterion.h>
+#include "../trive.hpp"
+
+using namespace trive::world;
+
+static void light_up (world_t* const world) {
+  for (auto chunk: world->chunks) {
+    light::seed(chunk);
+  }
+  world->relight();
+}
+
+Test(light, torch_lights_across_chunks_and_goes_out) {
+  world_t world(2, 1, 1);
+  light_up(&world);
+
+  chunk_t* const left = world.chunks[0];
+  chunk_t* const right = world.chunks[1];
+  const cell_t at = { { 30, 16, 16 }, 0 };
+
+  cr_assert(world.set(left, at, torch));
+  world.relight();
+
+  cr_assert_eq(left->get_light(at, block_light), 14);
+  for (uint8_t f = 0; f < tetra_faces; f++) {
+    cr_assert_eq(left->get_light(face_neighbor(at, f), block_light), 13);
+  }
+
+  const cell_t over_the_border = { { 1, 16, 16 }, 0 }, far_away = { { 0, 16, 16 }, 0 };
+  cr_assert_gt(right->get_light(over_the_border, block_light), 0);
+  cr_assert_eq(left->get_light(far_away, block_light), 0);
+
+  cr_assert(world.set(left, at, air));
+  world.relight();
+
+  size_t total = 0;
+  for (auto chunk: world.chunks) {
+    for (auto level: chunk->light[block_light]) {
+      total += level;
+    }
+  }
+  cr_assert_eq(total, 0);
+}
+
+Test(light, roof_shuts_out_the_sky) {
+  world_t world(1, 2, 1);
+  light_up(&world);
+
+  chunk_t* const bottom = world.chunks[0];
+  chunk_t* const top = world.chunks[1];
+  const cell_t below = { { 5, 5, 5 }, 3 }, above = { { 5, 20, 5 }, 3 };
+
+  cr_assert_eq(bottom->get_light(below, sky_light), max_light);
+
+  for (int32_t z = 0; z < static_cast<int32_t> (chunk_size); z++) {
+    for (int32_t x = 0; x < static_cast<int32_t> (chunk_size); x++) {
+      for (uint8_t t = 0; t < tetras_per_cube; t++) {
+        world.set(top, { { x, 8, z }, t }, stone);
+      }
+    }
+  }
+  world.relight();
+
+  cr_assert_eq(bottom->get_light(below, sky_light), 0);
+  cr_assert_eq(top->get_light(above, sky_light), max_light);
+  cr_assert_gt(world.light_stats.passes, 2);
+}
+
+static void build_overhang (world_t* const world) {
+  for (int32_t z = 0; z < static_cast<int32_t> (chunk_size); z++) {
+    for (int32_t x = 0; x < 16; x++) {
+      for (uint8_t t = 0; t < tetras_per_cube; t++) {
+        world->set(world->chunks[0], { { x, 20, z }, t }, stone);
+      }
+    }
+  }
+}
+
+// skylight only falls freely down its own column, so it can't reach far under a roof sideways
+Test(light, overhang_only_lets_light_in_from_the_side) {
+  world_t seeded(1, 1, 1), edited(1, 1, 1);
+  build_overhang(&seeded);
+  light_up(&seeded);
+
+  // the same roof put over a lit world has to take the light away again
+  light_up(&edited);
+  build_overhang(&edited);
+  edited.relight();
+
+  const chunk_t* const chunk = edited.chunks[0];
+  cr_assert_eq(chunk->get_light({ { 24, 5, 16 }, 3 }, sky_light), max_light);
+  cr_assert_lt(chunk->get_light({ { 15, 5, 16 }, 3 }, sky_light), max_light);
+  for (int32_t x = 0; x <= 8; x += 4) {
+    cr_assert_eq(chunk->get_light({ { x, 5, 16 }, 3 }, sky_light), 0);
+  }
+
+  cr_assert(seeded.chunks[0]->light[sky_light] == chunk->light[sky_light]);
+}
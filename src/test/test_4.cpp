@@ -0,0 +1,137 @@
+#include <criterion/criterion.h>
+#include "../trive.hpp"
+
+using namespace trive::world;
+using namespace trive::graphics::mesh;
+
+typedef std::array<long, 3> point_t;
+
+static point_t half_units (const vertex_t& vertex) {
+  point_t out;
+  for (uint8_t d = 0; d < dimensions; d++) {
+    out[d] = std::lround((vertex.position[d] - vertex_offset) / (vertex_scale / 2));
+  }
+  return out;
+}
+
+static std::vector<vertex_t> mesh_chunk (chunk_t* const chunk, const bool merge, merge_stats_t* const stats) {
+  std::vector<vertex_t> all, section;
+  for (uint32_t s = 0; s < chunk_sections; s++) {
+    mesh_section(*chunk, s, merge, &section, stats);
+    all.insert(all.end(), section.begin(), section.end());
+  }
+  return all;
+}
+
+// closed and crack-free: every edge is walked as often one way as the other, which a T-junction breaks
+static bool watertight (const std::vector<vertex_t>& verts) {
+  std::map< std::pair<point_t, point_t>, long > edges;
+
+  for (size_t i = 0; i < verts.size(); i += 3) {
+    for (size_t e = 0; e < 3; e++) {
+      edges[ { half_units(verts[i + e]), half_units(verts[i + (e + 1) % 3]) } ]++;
+    }
+  }
+
+  for (auto& edge: edges) {
+    const auto back = edges.find({ edge.first.second, edge.first.first });
+    if (edges.end() == back || back->second != edge.second) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static point_t minus (const point_t& a, const point_t& b) {
+  return { { a[0] - b[0], a[1] - b[1], a[2] - b[2] } };
+}
+
+static point_t cross (const point_t& a, const point_t& b) {
+  return { { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] } };
+}
+
+static long dot (const point_t& a, const point_t& b) {
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// no vertex lies on another triangle unless it's one of that triangle's corners
+static bool conforming (const std::vector<vertex_t>& verts) {
+  std::vector<point_t> points;
+  for (auto& vertex: verts) {
+    points.push_back(half_units(vertex));
+  }
+  std::sort(points.begin(), points.end());
+  points.erase(std::unique(points.begin(), points.end()), points.end());
+
+  for (size_t i = 0; i < verts.size(); i += 3) {
+    const point_t a = half_units(verts[i]), b = half_units(verts[i + 1]), c = half_units(verts[i + 2]);
+    const point_t normal = cross(minus(b, a), minus(c, a));
+
+    for (auto& p: points) {
+      if (p == a || p == b || p == c || 0 != dot(normal, minus(p, a))) {
+        continue;
+      }
+      if (0 <= dot(cross(minus(b, a), minus(p, a)), normal) && 0 <= dot(cross(minus(c, b), minus(p, b)), normal) && 0 <= dot(cross(minus(a, c), minus(p, c)), normal)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static double area (const std::vector<vertex_t>& verts) {
+  double total = 0;
+  for (size_t i = 0; i < verts.size(); i += 3) {
+    double ab[3], ac[3];
+    for (uint8_t d = 0; d < dimensions; d++) {
+      ab[d] = verts[i + 1].position[d] - verts[i].position[d];
+      ac[d] = verts[i + 2].position[d] - verts[i].position[d];
+    }
+    const double
+      x = ab[1] * ac[2] - ab[2] * ac[1],
+      y = ab[2] * ac[0] - ab[0] * ac[2],
+      z = ab[0] * ac[1] - ab[1] * ac[0];
+    total += std::sqrt(x * x + y * y + z * z) / 2;
+  }
+  return total;
+}
+
+Test(merge, box_stays_watertight) {
+  world_t world(1, 1, 1);
+  chunk_t* const chunk = world.chunks[0];
+
+  // straddles the section borders, with a notch cut out of its top
+  for (int32_t y = 2; y < 12; y++) {
+    for (int32_t z = 2; z < 12; z++) {
+      for (int32_t x = 2; x < 12; x++) {
+        for (uint8_t t = 0; t < tetras_per_cube; t++) {
+          const bool notch = 11 == y && 5 == x && 5 == z && 2 > t;
+          chunk->set({ { x, y, z }, t }, notch ? air : stone);
+        }
+      }
+    }
+  }
+
+  merge_stats_t plain, merged;
+  const std::vector<vertex_t> before = mesh_chunk(chunk, false, &plain), after = mesh_chunk(chunk, true, &merged);
+
+  cr_assert(watertight(before));
+  cr_assert(watertight(after));
+  cr_assert(conforming(after));
+  cr_assert_eq(plain.faces, merged.faces);
+  cr_assert_lt(merged.triangles * 2, plain.triangles);
+  cr_assert_lt(std::fabs(area(before) - area(after)), 1e-4);
+}
+
+Test(merge, terrain_shrinks_and_stays_watertight) {
+  world_t world(1, 1, 1);
+  world.generate_terrain();
+
+  merge_stats_t plain, merged;
+  const std::vector<vertex_t> before = mesh_chunk(world.chunks[0], false, &plain), after = mesh_chunk(world.chunks[0], true, &merged);
+
+  cr_assert(watertight(after));
+  cr_assert(conforming(after));
+  cr_assert_lt(merged.triangles, plain.triangles);
+  cr_assert_lt(std::fabs(area(before) - area(after)), 1e-3);
+}
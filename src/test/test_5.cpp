@@ -0,0 +1,52 @@
+#include <criterion/criterion.h>
+#include "../trive.hpp"
+
+using namespace trive::world;
+using namespace trive::graphics::mesh;
+using namespace trive::graphics::renderer;
+
+static size_t count_kind (const command_list_t& list, const uint8_t kind) {
+  size_t n = 0;
+  for (auto& command: list.commands) {
+    n += kind == command.kind;
+  }
+  return n;
+}
+
+Test(renderer, mesh_records_setup_then_patches) {
+  world_t world(1, 1, 1);
+  world.generate_terrain();
+  chunk_t* const chunk = world.chunks[0];
+
+  chunk_mesh_t chunk_mesh(0, 1);
+  command_list_t list;
+
+  chunk_mesh.update(chunk);
+  chunk_mesh.upload(&list);
+  chunk_mesh.draw(&list);
+
+  cr_assert_eq(count_kind(list, cmd_vertex_attrib), 2);
+  cr_assert_eq(count_kind(list, cmd_buffer_data), 1);
+  cr_assert_eq(count_kind(list, cmd_buffer_sub_data), 0);
+  cr_assert_eq(list.commands.back().kind, cmd_multi_draw);
+  cr_assert_eq(list.commands.back().count, chunk_sections);
+  cr_assert_eq(list.payload.size() % 8, 0);
+
+  // dig out the top of the middle column; the span still fits, so only the changed sections go over
+  const cell_t dig = chunk->top_solid(chunk_size / 2, chunk_size / 2);
+  cr_assert(world.set(chunk, dig, air));
+  world.relight();
+
+  list.reset();
+  chunk_mesh.update(chunk);
+  chunk_mesh.upload(&list);
+
+  size_t bytes = 0;
+  for (auto& command: list.commands) {
+    cr_assert_eq(command.kind, cmd_buffer_sub_data);
+    cr_assert_eq(command.buffer, chunk_mesh.vbo);
+    bytes += command.data_size;
+  }
+  cr_assert_gt(list.commands.size(), 0);
+  cr_assert_eq(bytes, chunk_mesh.stats.bytes_uploaded);
+}
@@ -0,0 +1,100 @@
+#include <criterion/criterion.h>
+#include "../trive.hpp"
+
+using namespace trive::world;
+using namespace trive::graphics::mesh;
+using namespace trive::graphics::renderer;
+
+static bool same_list (const command_list_t& a, const command_list_t& b) {
+  if (a.commands.size() != b.commands.size() || a.payload != b.payload) {
+    return false;
+  }
+
+  for (size_t i = 0; i < a.commands.size(); i++) {
+    const command_t& x = a.commands[i];
+    const command_t& y = b.commands[i];
+    if (x.kind != y.kind || x.object != y.object || x.buffer != y.buffer || x.index != y.index || x.count != y.count
+      || x.offset != y.offset || x.size != y.size || x.data != y.data || x.data_size != y.data_size) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Test(capture, frames_and_programs_round_trip) {
+  world_t world(1, 1, 1);
+  world.generate_terrain();
+
+  chunk_mesh_t chunk_mesh(0, 1);
+  command_list_t first, second;
+  static const GLfloat grey[] = { 0.5, 0.5, 0.5, 1.0 };
+
+  chunk_mesh.update(world.chunks[0]);
+  first.clear(grey);
+  first.use_program(7);
+  chunk_mesh.upload(&first);
+  chunk_mesh.draw(&first);
+  first.swap();
+
+  cr_assert(world.set(world.chunks[0], { { 3, 0, 3 }, 0 }, air));
+  world.relight();
+  chunk_mesh.update(world.chunks[0]);
+  chunk_mesh.upload(&second);
+  chunk_mesh.draw(&second);
+  second.swap();
+
+  const captured_program_t prog = { 7, { { 0, "in_Position" }, { 1, "in_Color" } }, { { GL_VERTEX_SHADER, "void main () {}\n" } } };
+
+  FILE* const file = std::tmpfile();
+  cr_assert_not_null(file);
+
+  capture_writer_t writer;
+  cr_assert(writer.open(file, 640, 480));
+  writer.program(prog);
+  writer.frame(first);
+  writer.frame(second);
+  cr_assert_not(writer.failed);
+  cr_assert_eq(writer.frames, 2);
+
+  // only what each command uses goes in, so it's well under the in-memory lists
+  cr_assert_lt(writer.bytes, nbytes(command_t, first.commands.size() + second.commands.size()) + first.payload.size() + second.payload.size());
+
+  std::rewind(file);
+  capture_t capture;
+  cr_assert(read_capture(file, &capture));
+  std::fclose(file);
+
+  cr_assert_eq(capture.width, 640);
+  cr_assert_eq(capture.height, 480);
+  cr_assert_eq(capture.programs.size(), 1);
+  cr_assert_eq(capture.programs[0].name, 7);
+  cr_assert_eq(capture.programs[0].attributes[1].name, "in_Color");
+  cr_assert_eq(capture.programs[0].stages[0].source, prog.stages[0].source);
+  cr_assert_eq(capture.frames.size(), 2);
+  cr_assert(same_list(capture.frames[0], first));
+  cr_assert(same_list(capture.frames[1], second));
+}
+
+Test(capture, truncated_file_is_rejected) {
+  command_list_t list;
+  list.use_program(1);
+
+  FILE* const whole = std::tmpfile();
+  capture_writer_t writer;
+  cr_assert(writer.open(whole, 1, 1));
+  writer.frame(list);
+
+  // the same file without the last byte of the program name
+  std::vector<char> bytes(writer.bytes);
+  std::rewind(whole);
+  cr_assert_eq(std::fread(bytes.data(), 1, bytes.size(), whole), bytes.size());
+  std::fclose(whole);
+
+  FILE* const cut = std::tmpfile();
+  std::fwrite(bytes.data(), 1, bytes.size() - 1, cut);
+  std::rewind(cut);
+
+  capture_t capture;
+  cr_assert_not(read_capture(cut, &capture));
+  std::fclose(cut);
+}
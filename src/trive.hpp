@@ -1,9 +1,18 @@
 #ifndef HEADER_TRIVE_HPP
 #define HEADER_TRIVE_HPP
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstring>
 #include <cstdio>
 #include <cerrno>
+#include <cmath>
+#include <cstddef>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
 #include <vector>
 #include <sys/stat.h>
 
@@ -50,6 +59,113 @@ namespace trive {
     * const program_name = "SDL2 + OpenGL Thing",
     * const program_version = "0.0.1";
 
+  namespace world {
+
+    static const uint32_t
+      dimensions = 3, tetra_verticies = 4, tetra_faces = 4, tetras_per_cube = 6,
+      chunk_size = 32, section_size = 8, sections_per_edge = chunk_size / section_size,
+      chunk_cells = chunk_size * chunk_size * chunk_size * tetras_per_cube,
+      chunk_sections = sections_per_edge * sections_per_edge * sections_per_edge,
+      chunk_neighbors = 6, light_channels = 2;
+
+    static const uint8_t max_light = 15;
+
+    enum material_t : uint8_t { air = 0, stone, dirt, grass, torch, material_count };
+
+    enum light_channel_t : uint8_t { block_light = 0, sky_light };
+
+    enum light_offer_kind_t : uint8_t { offer_add = 0, offer_remove, offer_dirty };
+
+    // a tetrahedron: the cube it's in (chunk-local, may lie just outside the chunk) and which of the cube's six it is
+    struct cell_t {
+      int32_t cube[dimensions];
+      uint8_t t;
+    };
+
+    void cell_verticies (const cell_t&, int32_t out[tetra_verticies][dimensions]);
+    cell_t face_neighbor (const cell_t&, const uint8_t);
+
+    class chunk_t;
+
+    struct light_node_t {
+      uint32_t index;
+      uint8_t level;
+    };
+
+    // light (or a light change) crossing into a neighboring chunk; held back until the pass is over so chunks can be lit in parallel
+    struct light_offer_t {
+      chunk_t* chunk;
+      uint32_t index;
+      uint8_t level, channel, kind;
+      bool downward;
+    };
+
+    struct light_stats_t {
+      size_t passes = 0, cells_visited = 0, threads_used = 0;
+      double relight_ms = 0;
+    };
+
+    class chunk_t {
+      public:
+        int32_t origin[dimensions]; // in chunks, not cubes
+
+        std::vector<uint8_t> materials;
+        std::vector<uint8_t> light[light_channels];
+
+        chunk_t* neighbors[chunk_neighbors] = {}; // -x, +x, -y, +y, -z, +z
+
+        std::vector<light_node_t> light_add[light_channels], light_remove[light_channels];
+        std::vector<light_offer_t> light_outbox;
+
+        std::vector<bool> dirty_sections;
+        std::vector<uint32_t> dirty_list;
+
+        bool edit_pending = false;
+        std::chrono::steady_clock::time_point edit_time;
+
+        chunk_t (const int32_t, const int32_t, const int32_t) noexcept;
+        static bool contains (const cell_t&);
+        static uint32_t cell_index (const cell_t&);
+        static uint32_t section_index (const cell_t&);
+        static cell_t index_cell (const uint32_t);
+        chunk_t* resolve (cell_t* const) const;
+        uint8_t get (const cell_t&) const;
+        uint8_t get_light (const cell_t&, const uint8_t) const;
+        cell_t top_solid (const int32_t, const int32_t) const;
+        bool set (const cell_t&, const uint8_t);
+        void generate_terrain (void);
+        void mark_dirty (const cell_t&);
+        void mark_all_dirty (void);
+        bool take_dirty (std::vector<uint32_t>* const, bool* const, std::chrono::steady_clock::time_point* const);
+    };
+
+    class world_t {
+      public:
+        int32_t size[dimensions]; // in chunks
+
+        std::vector<chunk_t*> chunks;
+
+        light_stats_t light_stats;
+
+        world_t (const int32_t, const int32_t, const int32_t) noexcept;
+        ~world_t (void) noexcept;
+        chunk_t* chunk_at (const int32_t, const int32_t, const int32_t) const;
+        void generate_terrain (void);
+        bool set (chunk_t* const, const cell_t&, const uint8_t);
+        void relight (void);
+        void print_light_stats (void);
+    };
+
+    namespace light {
+      bool opaque (const uint8_t);
+      uint8_t emission (const uint8_t);
+      bool sky_source (const chunk_t&, const cell_t&);
+      void seed (chunk_t* const);
+      void on_edit (chunk_t* const, const cell_t&);
+      void propagate (const std::vector<chunk_t*>&, light_stats_t* const);
+    }
+  }
+
   namespace graphics {
 
     static const uint32_t
@@ -57,11 +173,24 @@ namespace trive {
       space_dimensions = 3, color_dimensions = 4, square_verticies = 4;
 
     namespace shader {
+      // kept so a capture can rebuild the program somewhere else
+      struct stage_source_t {
+        GLenum type;
+        std::string source;
+      };
+
+      struct attribute_t {
+        GLuint index;
+        std::string name;
+      };
+
       class shader_t {
         public:
           static const size_t max_shader_len = 4000;
 
           std::vector<GLuint>* shader_ids;
+          std::vector<stage_source_t> stages;
+          std::vector<attribute_t> attributes;
 
           GLuint shader_program = 0;
 
@@ -82,8 +211,201 @@ namespace trive {
       };
     }
 
+    namespace renderer {
+
+      enum command_kind_t : uint8_t {
+        cmd_clear = 0, cmd_use_program, cmd_buffer_data, cmd_buffer_sub_data, cmd_vertex_attrib, cmd_multi_draw, cmd_swap, command_kinds
+      };
+
+      // one GL call, or a few that always go together; buffers and vertex arrays are named by handles from new_handle(),
+      // since only the thread that owns the context can make real GL names
+      struct command_t {
+        uint8_t kind;
+        uint32_t object, buffer;  // vertex array and buffer, or the program for use_program
+        uint32_t index, count;    // attribute index and components, draw mode and span count, or buffer usage
+        uint64_t offset, size;    // bytes into the buffer, or the attribute's offset and stride
+        size_t data, data_size;   // the call's array arguments, in the list's payload
+      };
+
+      class command_list_t {
+        public:
+          std::vector<command_t> commands;
+          std::vector<uint8_t> payload;
+
+          void reset (void);
+          size_t push_payload (const void* const, const size_t);
+          void clear (const GLfloat* const);
+          void use_program (const GLuint);
+          void buffer_data (const uint32_t, const uint64_t, const void* const, const size_t);
+          void buffer_sub_data (const uint32_t, const uint64_t, const void* const, const size_t);
+          void vertex_attrib (const uint32_t, const uint32_t, const uint32_t, const uint32_t, const uint64_t, const uint64_t);
+          void multi_draw (const uint32_t, const GLenum, const GLint* const, const GLsizei* const, const uint32_t);
+          void swap (void);
+      };
+
+      // a capture file is a header, then records: whatever programs the capturer writes up front (run_game writes the one
+      // it draws with) and every command list as it was played, each command written with only the fields its kind uses,
+      // in native byte order
+      static const char capture_magic[4] = { 't', 'r', 'v', 'c' };
+      static const uint32_t capture_version = 1;
+
+      enum capture_record_t : uint8_t {
+        rec_program = 0, rec_frame
+      };
+
+      struct captured_program_t {
+        GLuint name;
+        std::vector<shader::attribute_t> attributes;
+        std::vector<shader::stage_source_t> stages;
+      };
+
+      struct capture_t {
+        uint32_t width = 0, height = 0;
+        std::vector<captured_program_t> programs;
+        std::vector<command_list_t> frames;
+      };
+
+      class capture_writer_t {
+        public:
+          FILE* file = nullptr;
+          uint64_t frames = 0, bytes = 0;
+          bool failed = false;
+
+          bool open (FILE* const, const uint32_t, const uint32_t);
+          void write (const void* const, const size_t);
+          void program (const captured_program_t&);
+          void frame (const command_list_t&);
+      };
+
+      bool read_capture (FILE* const, capture_t* const);
+      GLuint build_program (const captured_program_t&);
+
+      // plays command lists back on whichever thread has the GL context
+      class executor_t {
+        public:
+          SDL_Window* window;
+
+          // by handle; a map, since a capture can hold any handle at all
+          std::map<uint32_t, GLuint> buffers, arrays;
+
+          // programs from a capture, by the name they had when it was made
+          std::map<GLuint, GLuint> programs;
+
+          executor_t (SDL_Window* const) noexcept;
+          ~executor_t (void) noexcept;
+          GLuint buffer (const uint32_t);
+          GLuint array (const uint32_t);
+          GLuint program (const GLuint);
+          void execute (const command_list_t&);
+          void release (void);
+      };
+
+      struct thread_timing_t {
+        std::atomic<uint64_t> busy_ns, wait_ns, last_busy_ns;
+
+        thread_timing_t (void) noexcept;
+      };
+
+      // the simulation thread fills one list while the render thread plays the other; each side only ever waits on the
+      // other's frame counter, so there are no locks
+      class render_thread_t {
+        public:
+          SDL_Window* window;
+          SDL_GLContext context;
+          capture_writer_t* capture = nullptr;
+
+          command_list_t lists[2];
+          std::atomic<uint64_t> submitted, consumed;
+          std::atomic<bool> running;
+
+          thread_timing_t simulation, render;
+          std::atomic<uint64_t> capture_ns;
+          std::chrono::steady_clock::time_point started, frame_started;
+          std::thread thread;
+
+          render_thread_t (SDL_Window* const, SDL_GLContext) noexcept;
+          ~render_thread_t (void) noexcept;
+          void start (void);
+          void stop (void);
+          command_list_t* begin_frame (void);
+          void submit (void);
+          void loop (void);
+          void print_timing (void);
+      };
+
+      uint32_t new_handle (void);
+      size_t padded (const size_t);
+    }
+
+    namespace mesh {
+
+      // verticies; spans are sized in multiples of this so a few extra faces can be patched in place
+      static const size_t span_granularity = 48;
+
+      // until there's a camera, chunk space goes straight to clip space
+      static const GLfloat vertex_scale = 1.0f / world::chunk_size, vertex_offset = -1.0f;
+
+      struct vertex_t {
+        GLfloat position[space_dimensions];
+        GLfloat color[color_dimensions];
+      };
+
+      // a run of a section's verticies to copy into the vertex buffer
+      struct upload_t {
+        uint32_t section;
+        size_t first, count;
+      };
+
+      // exposed faces in, triangles out
+      struct merge_stats_t {
+        size_t faces = 0, triangles = 0;
+        double merge_ms = 0;
+      };
+
+      struct mesh_stats_t {
+        uint64_t updates = 0, reallocations = 0, bytes_uploaded_total = 0;
+        size_t sections_remeshed = 0, bytes_uploaded = 0;
+        double remesh_ms = 0, upload_ms = 0, edit_to_visible_ms = 0;
+        merge_stats_t merged;
+      };
+
+      void mesh_section (const world::chunk_t&, const uint32_t, const bool, std::vector<vertex_t>* const, merge_stats_t* const);
+
+      class chunk_mesh_t {
+        public:
+          uint32_t vbo = 0, vao = 0; // command list handles
+          GLuint pos_attr_index, color_attr_index;
+
+          // CPU copy of every section's verticies, and where each one lives in the vertex buffer
+          std::vector< std::vector<vertex_t> > sections;
+          std::vector<GLint> firsts;
+          std::vector<GLsizei> counts;
+          std::vector<size_t> capacities;
+
+          // all in verticies
+          size_t buffer_capacity = 0, buffer_end = 0, garbage = 0;
+
+          bool needs_realloc = false, merge_coplanar = true;
+          std::vector<upload_t> uploads;
+
+          bool edit_pending = false;
+          std::chrono::steady_clock::time_point edit_time;
+
+          mesh_stats_t stats;
+
+          chunk_mesh_t (const GLuint, const GLuint) noexcept;
+          size_t update (world::chunk_t* const);
+          void place_span (const uint32_t);
+          void defragment (void);
+          void upload (renderer::command_list_t* const);
+          void draw (renderer::command_list_t* const);
+          void note_visible (void);
+          void print_stats (void);
+      };
+    }
+
     bool init (SDL_Window* * const, SDL_GLContext* const, shader::shader_t** const);
-    bool run_game (SDL_Window* const * const);
+    bool run_game (SDL_Window* const * const, SDL_GLContext* const, shader::shader_t* const, const GLuint, const GLuint);
     void render (SDL_Window* const * const, const GLuint);
     void black_window (SDL_Window* const * const);
     bool setup_buffer_objects (shader::shader_t** const, GLuint* const, const size_t, GLuint* const, const size_t, const GLuint, const GLuint);